@@ -0,0 +1,31 @@
+#include "arena.h"
+
+Arena* Arena::current = 0;
+
+Arena::Arena() : bytes(), count()
+{
+}
+
+Arena& Arena::Global()
+{
+    static Arena global;
+    return global;
+}
+
+void* Arena::Allocate(size_t size, Kind k)
+{
+    Arena& a = Current();
+    a.bytes[k] += size;
+    a.count[k]++;
+    return a.alloc.Allocate(size, alignof(std::max_align_t));
+}
+
+void Arena::PrintStats(std::ostream& out) const
+{
+    static const char* names[NumKinds] = { "AST nodes", "Types", "Constants" };
+    for(int i = 0; i < NumKinds; i++)
+    {
+	out << names[i] << ": " << count[i] << " objects, " << bytes[i] << " bytes" << std::endl;
+    }
+    out << "Arena: " << alloc.getTotalMemory() << " bytes reserved" << std::endl;
+}
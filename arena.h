@@ -0,0 +1,54 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <llvm/Support/Allocator.h>
+#include <cstddef>
+#include <ostream>
+
+// Memory for AST nodes, types and constants. These are never deleted one by
+// one; they are allocated from the current arena, and all of it is released
+// together when the arena goes away. Objects created with no arena in use
+// (e.g. the builtin types) go in the global arena, which lives forever.
+class Arena
+{
+public:
+    enum Kind
+    {
+	AST,
+	Type,
+	Const,
+	NumKinds,
+    };
+
+    Arena();
+    ~Arena() {}
+
+    static void* Allocate(size_t size, Kind k);
+    static Arena& Global();
+    static Arena& Current() { return current ? *current : Global(); }
+
+    void PrintStats(std::ostream& out) const;
+
+private:
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    friend class ArenaScope;
+    static Arena* current;
+
+    llvm::BumpPtrAllocator alloc;
+    size_t                 bytes[NumKinds];
+    size_t                 count[NumKinds];
+};
+
+// Make an arena the current one for the lifetime of the scope.
+class ArenaScope
+{
+public:
+    ArenaScope(Arena& a) : prev(Arena::current) { Arena::current = &a; }
+    ~ArenaScope() { Arena::current = prev; }
+private:
+    Arena* prev;
+};
+
+#endif
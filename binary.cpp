@@ -2,6 +2,8 @@
 #include "options.h"
 #include "trace.h"
 #include "expr.h"
+#include "unitcache.h"
+#include "link.h"
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wunused-function"
 #include <llvm/CodeGen/CommandFlags.def>
@@ -21,7 +23,14 @@
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/DataLayout.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Analysis/ModuleSummaryAnalysis.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
 #include <iostream>
+#include <mutex>
+#include <thread>
 #include <system_error>
 
 static llvm::ToolOutputFile *GetOutputStream(const std::string& filename)
@@ -40,49 +49,115 @@ static llvm::ToolOutputFile *GetOutputStream(const std::string& filename)
     return FDOut;
 }
 
-static void CreateObject(llvm::Module *module, const std::string& objname)
+static std::string targetCPU;
+static std::string targetFeatures;
+
+// Done once, as objects may be created on several threads, and in the server, before
+// any request.
+void InitializeTargets()
 {
-    TIME_TRACE();
-    llvm::InitializeAllTargets();
-    llvm::InitializeAllTargetMCs();
-    llvm::InitializeAllAsmPrinters();
-    llvm::InitializeAllAsmParsers();
+    static std::once_flag once;
+    std::call_once(once, []()
+    {
+	llvm::InitializeAllTargets();
+	llvm::InitializeAllTargetMCs();
+	llvm::InitializeAllAsmPrinters();
+	llvm::InitializeAllAsmParsers();
+    });
+}
 
-    std::string error;
-    llvm::Triple triple = llvm::Triple(module->getTargetTriple());
-    const llvm::Target *target = llvm::TargetRegistry::lookupTarget(triple.getTriple(), error);
+// -march=native is the host, so the target is found from the triple.
+static std::string TargetArch()
+{
+    return (MArch == "native") ? "" : MArch;
+}
 
-    if (!target)
+void ResolveTarget()
+{
+    llvm::SubtargetFeatures features;
+    targetCPU = MCPU;
+    // -march=native or -mcpu=native: the host CPU, with all its features.
+    if (MArch == "native" || MCPU == "native")
     {
-	std::cerr << "Error, could not find target: " << error << std::endl;
-	return;
+	targetCPU = sys::getHostCPUName();
+	llvm::StringMap<bool> hostFeatures;
+	if (sys::getHostCPUFeatures(hostFeatures))
+	{
+	    for(auto& f : hostFeatures)
+	    {
+		features.AddFeature(f.first(), f.second);
+	    }
+	}
     }
+    for(auto& a : MAttrs)
+    {
+	features.AddFeature(a);
+    }
+    targetFeatures = features.getString();
+}
+
+const std::string& TargetCPU()
+{
+    return targetCPU;
+}
+
+const std::string& TargetFeatures()
+{
+    return targetFeatures;
+}
+
+std::string TargetTriple()
+{
+    InitializeTargets();
 
-    if (MCPU == "native")
+    llvm::Triple triple(llvm::sys::getDefaultTargetTriple());
+    if (model == m32)
     {
-	MCPU = sys::getHostCPUName();
+	triple = triple.get32BitArchVariant();
     }
+    else
+    {
+	triple = triple.get64BitArchVariant();
+    }
+    // With -march, the target is looked up by name, and the triple adjusted.
+    std::string error;
+    llvm::TargetRegistry::lookupTarget(TargetArch(), triple, error);
+    return triple.getTriple();
+}
+
+llvm::TargetMachine* CreateTargetMachine(const std::string& tripleName, llvm::Reloc::Model reloc)
+{
+    InitializeTargets();
 
-    std::string FeaturesStr;
-    if (MAttrs.size())
+    std::string error;
+    llvm::Triple triple(tripleName);
+    // With -march, the target is looked up by name, and the triple adjusted.
+    const llvm::Target *target = llvm::TargetRegistry::lookupTarget(TargetArch(), triple, error);
+    if (!target)
     {
-	llvm::SubtargetFeatures Features;
-	for (unsigned i = 0; i != MAttrs.size(); ++i)
-	{
-	    Features.AddFeature(MAttrs[i]);
-	}
-	FeaturesStr = Features.getString();
+	std::cerr << "Error, could not find target: " << error << std::endl;
+	return 0;
     }
 
     llvm::TargetOptions options;
-    std::unique_ptr<llvm::TargetMachine> tm
-	(target->createTargetMachine(triple.getTriple(), MCPU,
-				     FeaturesStr, options, llvm::Reloc::Static));
-
+    llvm::TargetMachine* tm = target->createTargetMachine(triple.getTriple(), targetCPU,
+							  targetFeatures, options, reloc);
     if (!tm)
     {
 	std::cerr << "Error: Could not create targetmachine." << std::endl;
-	return;
+    }
+    return tm;
+}
+
+static bool EmitFile(llvm::Module *module, const std::string& objname,
+		     llvm::TargetMachine::CodeGenFileType fileType)
+{
+    TIME_TRACE();
+    llvm::Triple triple = llvm::Triple(module->getTargetTriple());
+    std::unique_ptr<llvm::TargetMachine> tm(CreateTargetMachine(triple.getTriple()));
+    if (!tm)
+    {
+	return false;
     }
 
     llvm::legacy::PassManager PM;
@@ -94,19 +169,120 @@ static void CreateObject(llvm::Module *module, const std::string& objname)
     if (!Out)
     {
 	std::cerr << "Could not open file ... " << std::endl;
-	return;
+	return false;
     }
 
     llvm::raw_pwrite_stream *OS = &Out->os();
 
-    if (tm->addPassesToEmitFile(PM, *OS, llvm::LLVMTargetMachine::CGFT_ObjectFile, false))
+    if (tm->addPassesToEmitFile(PM, *OS, fileType, false))
     {
 	std::cerr << objname << ": target does not support generation of this"
 	    " file type!\n";
-	return;
+	return false;
     }
     PM.run(*module);
     Out->keep();
+    return true;
+}
+
+// With ThinLTO, the "object" is bitcode with a summary of the module, and a hash of
+// it that the linker uses as key in its cache. Code is generated at link time.
+static bool WriteThinLTOBitcode(llvm::Module *module, const std::string& objname)
+{
+    TIME_TRACE();
+    std::unique_ptr<llvm::ToolOutputFile> Out(GetOutputStream(objname));
+    if (!Out)
+    {
+	std::cerr << "Could not open file " << objname << std::endl;
+	return false;
+    }
+    llvm::ModuleSummaryIndex index = llvm::buildModuleSummaryIndex(*module, nullptr, nullptr);
+    llvm::WriteBitcodeToFile(module, Out->os(), false, &index, true);
+    Out->keep();
+    return true;
+}
+
+bool CreateObject(llvm::Module *module, const std::string& objname)
+{
+    if (thinLTO)
+    {
+	return WriteThinLTOBitcode(module, objname);
+    }
+    return EmitFile(module, objname, llvm::LLVMTargetMachine::CGFT_ObjectFile);
+}
+
+std::string ModuleToBitcode(const llvm::Module* module)
+{
+    std::string bitcode;
+    llvm::raw_string_ostream os(bitcode);
+    llvm::WriteBitcodeToFile(module, os);
+    return os.str();
+}
+
+std::unique_ptr<llvm::Module> BitcodeToModule(const std::string& bitcode, llvm::LLVMContext& context)
+{
+    auto module = llvm::parseBitcodeFile(llvm::MemoryBufferRef(bitcode, "part"), context);
+    if (!module)
+    {
+	llvm::consumeError(module.takeError());
+	return 0;
+    }
+    return std::move(*module);
+}
+
+// Split the module into parts, and create an object file for each part on its own
+// thread. The parts are moved to their own LLVMContext as bitcode.
+static bool CreateObjectParts(llvm::Module *module, const std::string& filename, int parts,
+			      std::vector<std::string>& objnames)
+{
+    TIME_TRACE();
+    InitializeTargets();
+    std::vector<std::string> bitcode;
+    // Local symbols become hidden external ones for the split, as keeping them with
+    // their users would put an internalized whole program in one part. Like ThinLTO
+    // promotion, they first get names of their own for this module, so they don't
+    // clash with the locals of units, or with runtime symbols, when linking.
+    std::unique_ptr<llvm::Module> clone = llvm::CloneModule(module);
+    std::string suffix = ".llvm." + UnitCache::Hash(filename.data(), filename.size());
+    for(auto& gv : clone->global_values())
+    {
+	if (gv.hasLocalLinkage())
+	{
+	    gv.setName((gv.hasName() ? gv.getName().str() : "unnamed") + suffix);
+	}
+    }
+    llvm::SplitModule(std::move(clone), parts,
+		      [&bitcode](std::unique_ptr<llvm::Module> part)
+		      {
+			  bitcode.push_back(ModuleToBitcode(part.get()));
+		      }, false);
+
+    std::vector<int> done(bitcode.size());
+    std::vector<std::thread> workers;
+    for(size_t i = 0; i < bitcode.size(); i++)
+    {
+	std::string objname = replace_ext(filename, ".pas", "." + std::to_string(i) + ".o");
+	objnames.push_back(objname);
+	// The name is copied, as objnames may be reallocated while the thread runs.
+	workers.push_back(std::thread([&bitcode, &done, i, objname]()
+	{
+	    llvm::LLVMContext context;
+	    std::unique_ptr<llvm::Module> part = BitcodeToModule(bitcode[i], context);
+	    done[i] = part && CreateObject(part.get(), objname);
+	}));
+    }
+    for(auto& w : workers)
+    {
+	w.join();
+    }
+    for(auto d : done)
+    {
+	if (!d)
+	{
+	    return false;
+	}
+    }
+    return true;
 }
 
 std::string replace_ext(const std::string &origName,
@@ -124,55 +300,130 @@ std::string replace_ext(const std::string &origName,
 bool CreateBinary(llvm::Module *module, const std::string& filename, EmitType emit)
 {
     TIME_TRACE();
-    if (emit == Exe)
+    switch(emit)
     {
-	std::string objname = replace_ext(filename, ".pas", ".o");
-	std::string exename = replace_ext(filename, ".pas", "");
-	std::string modelStr;
+    case LlvmIr:
+    {
+	std::string irName = replace_ext(filename, ".pas", ".ll");
+	std::unique_ptr<llvm::ToolOutputFile> Out(GetOutputStream(irName));
+	llvm::formatted_raw_ostream FOS(Out->os());
+	module->print(FOS, 0);
+	Out->keep();
+	return true;
+    }
+
+    case Bitcode:
+    {
+	std::unique_ptr<llvm::ToolOutputFile> Out(GetOutputStream(replace_ext(filename, ".pas",
+									      ".bc")));
+	if (!Out)
+	{
+	    return false;
+	}
+	llvm::WriteBitcodeToFile(module, Out->os());
+	Out->keep();
+	return true;
+    }
+
+    case Asm:
+	return EmitFile(module, replace_ext(filename, ".pas", ".s"),
+			llvm::LLVMTargetMachine::CGFT_AssemblyFile);
+
+    case Obj:
+	return CreateObject(module, replace_ext(filename, ".pas", ".o"));
+
+    case Exe:
+	break;
+    }
+
+    std::string objname = replace_ext(filename, ".pas", ".o");
+    std::string exename = replace_ext(filename, ".pas", "");
+    std::string modelStr;
 
 // Order matters here: clang, being gcc-compatible, will have __GNUC__ defined.
 #ifdef __clang__
-	std::string compiler = "clang";
+    std::string compiler = "clang";
 #elif defined(__GNUC__)
-	std::string compiler = "gcc";
+    std::string compiler = "gcc";
 #endif
-	if (model == m32)
-	{
-	    modelStr = "-m32";
-	}
+    if (model == m32)
+    {
+	modelStr = "-m32";
+    }
 
-	CreateObject(module, objname);
-	std::string verboseflags;
-	if (verbosity)
-	{
-	    verboseflags = " -v";
-	}
-	std::string debugFlag;
-	if (debugInfo)
-	{
-	    debugFlag = " -g";
-	}
-	std::string cmd = compiler + " " + modelStr + verboseflags + " " + objname +
-	    " -L\"" + libpath + "\" -lruntime" + modelStr + debugFlag + " -lm -o " + exename;
-	if (verbosity)
+    std::vector<std::string> objnames;
+    if (jobs > 1 && !thinLTO)
+    {
+	if (!CreateObjectParts(module, filename, jobs, objnames))
 	{
-	    std::cerr << "Executing final link command: " << cmd << std::endl;
+	    return false;
 	}
-	int res = system(cmd.c_str());
-	if (res != 0)
+    }
+    else
+    {
+	if (!CreateObject(module, objname))
 	{
-	    std::cerr << "Error: " << res << std::endl;
 	    return false;
 	}
+	objnames.push_back(objname);
+    }
+    std::vector<std::string> extraObjects = UnitCache::Objects();
+    if (profileGenerate)
+    {
+	// The profile runtime writes the profile when the program exits.
+	extraObjects.push_back(PROFILE_RT_LIB);
+    }
+
+    std::vector<std::string> allObjects = objnames;
+    allObjects.insert(allObjects.end(), extraObjects.begin(), extraObjects.end());
+    if (LinkInProcess(allObjects, exename))
+    {
 	return true;
     }
-    assert(emit == LlvmIr && "Expect LLVM IR here..");
 
-    std::string irName = replace_ext(filename, ".pas", ".ll");
-    std::unique_ptr<llvm::ToolOutputFile> Out(GetOutputStream(irName));
-    llvm::formatted_raw_ostream FOS(Out->os());
-    module->print(FOS, 0);
-    Out->keep();
+    std::string objects;
+    for(auto& o : objnames)
+    {
+	objects += " " + o;
+    }
+    for(auto& u : extraObjects)
+    {
+	objects += " \"" + u + "\"";
+    }
+    std::string verboseflags;
+    if (verbosity)
+    {
+	verboseflags = " -v";
+    }
+    std::string debugFlag;
+    if (debugInfo)
+    {
+	debugFlag = " -g";
+    }
+    // The objects are bitcode, so the driver has to use a linker that does LTO.
+    // Otherwise they are built for the static relocation model, which can't be
+    // linked into a position independent executable.
+    std::string linkFlags;
+    if (thinLTO)
+    {
+	linkFlags = " -flto=thin -fuse-ld=lld";
+    }
+    else
+    {
+	linkFlags = " -no-pie";
+    }
+    std::string cmd = compiler + " " + modelStr + verboseflags + linkFlags + objects +
+	" -L\"" + libpath + "\" -lruntime" + modelStr + debugFlag + " -lm -o " + exename;
+    if (verbosity)
+    {
+	std::cerr << "Executing final link command: " << cmd << std::endl;
+    }
+    int res = system(cmd.c_str());
+    if (res != 0)
+    {
+	std::cerr << "Error: " << res << std::endl;
+	return false;
+    }
     return true;
 }
 
@@ -182,39 +433,14 @@ llvm::Module* CreateModule()
 
     llvm::Module* module = new llvm::Module("TheModule", theContext);
 
-    llvm::Triple triple(llvm::sys::getDefaultTargetTriple());
-    if (model == m32)
-    {
-	triple = triple.get32BitArchVariant();
-    }
-    else
-    {
-	triple = triple.get64BitArchVariant();
-    }
-    module->setTargetTriple(triple.getTriple());
-    std::string error;
-    const llvm::Target *target = llvm::TargetRegistry::lookupTarget(triple.getTriple(), error);
-    if (!target)
+    std::string triple = TargetTriple();
+    module->setTargetTriple(triple);
+    std::unique_ptr<llvm::TargetMachine> tm(CreateTargetMachine(triple));
+    if (!tm)
     {
-	std::cerr << "Error, could not find target: " << error << std::endl;
 	return 0;
     }
-
-    std::string FeaturesStr;
-    if (MAttrs.size())
-    {
-	llvm::SubtargetFeatures Features;
-	for (unsigned i = 0; i != MAttrs.size(); ++i)
-	{
-	    Features.AddFeature(MAttrs[i]);
-	}
-	FeaturesStr = Features.getString();
-    }
-
-    llvm::TargetOptions options;
-    std::unique_ptr<llvm::TargetMachine> tm(target->createTargetMachine(triple.getTriple(), MCPU,
-									FeaturesStr, options, llvm::Reloc::Static));
-    assert(tm && "Could not create TargetMachine");
+    module->setTargetTriple(tm->getTargetTriple().str());
     const llvm::DataLayout dl = tm->createDataLayout();
     module->setDataLayout(dl);
     return module;
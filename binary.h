@@ -3,9 +3,29 @@
 #include "options.h"
 #include <string>
 #include <llvm/IR/Module.h>
+#include <llvm/Target/TargetMachine.h>
 
+llvm::TargetMachine* CreateTargetMachine(const std::string& triple,
+					 llvm::Reloc::Model reloc = llvm::Reloc::Static);
+// Sets up the LLVM targets, once for the whole process.
+void InitializeTargets();
+// Works out the CPU and features from -march, -mcpu and -mattr, for each compile.
+void ResolveTarget();
+// CPU and features from ResolveTarget, for function attributes.
+const std::string& TargetCPU();
+const std::string& TargetFeatures();
+// The triple for -m32/-m64 and -march.
+std::string TargetTriple();
+bool CreateObject(llvm::Module *module, const std::string& objname);
 bool CreateBinary(llvm::Module *module, const std::string& fileName, EmitType emit);
 
 llvm::Module* CreateModule();
 
+std::string ModuleToBitcode(const llvm::Module* module);
+std::unique_ptr<llvm::Module> BitcodeToModule(const std::string& bitcode, llvm::LLVMContext& context);
+
+std::string replace_ext(const std::string &origName,
+			const std::string& expectedExt,
+			const std::string& newExt);
+
 #endif
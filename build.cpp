@@ -0,0 +1,277 @@
+#include "build.h"
+#include "lexer.h"
+#include "source.h"
+#include "unitcache.h"
+#include "utils.h"
+#include "trace.h"
+#include "options.h"
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <vector>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+class UnitGraph
+{
+public:
+    enum State
+    {
+	Waiting,
+	Running,
+	Done,
+    };
+
+    struct Unit
+    {
+	std::string      fileName;
+	std::vector<int> deps;
+	State            state;
+    };
+
+    bool Scan(const std::string& fileName);
+    int  Build(int jobs, std::function<int(const std::string&)> compileUnit);
+
+private:
+    int  Add(const std::string& fileName);
+    bool Ready(const Unit& unit) const;
+    int  Wait(std::map<pid_t, int>& children);
+
+private:
+    std::vector<Unit>          units;
+    std::map<std::string, int> index;
+    std::vector<std::string>   visiting;
+};
+
+static std::string Canonical(const std::string& name)
+{
+    llvm::SmallString<256> path(name);
+    llvm::sys::fs::make_absolute(path);
+    llvm::sys::path::remove_dots(path, true);
+    return path.str().str();
+}
+
+// Find the units named in "uses" clauses. The parser only needs the tokens for this.
+static bool ScanUses(const std::string& fileName, std::vector<std::string>& used)
+{
+    MappedFileSource source(fileName);
+    if (!source)
+    {
+	std::cerr << "Could not open " << fileName << std::endl;
+	return false;
+    }
+    Lexer lex(source);
+    std::string path = GetPath(fileName);
+    bool inUses = false;
+    for(;;)
+    {
+	Token t = lex.GetToken();
+	switch(t.GetToken())
+	{
+	case Token::EndOfFile:
+	    return true;
+
+	case Token::Unknown:
+	    // Let the compiler report the error.
+	    return true;
+
+	case Token::Uses:
+	    inUses = true;
+	    break;
+
+	case Token::Identifier:
+	    if (inUses)
+	    {
+		std::string name = t.GetIdentName();
+		strlower(name);
+		// The math unit is built in.
+		if (name != "math")
+		{
+		    used.push_back(path + "/" + name + ".pas");
+		}
+	    }
+	    break;
+
+	case Token::Comma:
+	    break;
+
+	default:
+	    inUses = false;
+	    break;
+	}
+    }
+}
+
+// The program itself is compiled by the caller, so only what it uses is added.
+bool UnitGraph::Scan(const std::string& fileName)
+{
+    std::vector<std::string> used;
+    if (!ScanUses(fileName, used))
+    {
+	return false;
+    }
+    for(auto& u : used)
+    {
+	if (Add(u) < 0)
+	{
+	    return false;
+	}
+    }
+    return true;
+}
+
+// Add the unit and everything it uses, depth first. Returns the index of the
+// unit, or -1 on error.
+int UnitGraph::Add(const std::string& fileName)
+{
+    std::string name = Canonical(fileName);
+    auto it = index.find(name);
+    if (it != index.end())
+    {
+	return it->second;
+    }
+    for(auto& v : visiting)
+    {
+	if (v == name)
+	{
+	    std::cerr << "Circular unit dependency involving " << fileName << std::endl;
+	    return -1;
+	}
+    }
+
+    std::vector<std::string> used;
+    if (!ScanUses(fileName, used))
+    {
+	return -1;
+    }
+    visiting.push_back(name);
+    std::vector<int> deps;
+    for(auto& u : used)
+    {
+	int dep = Add(u);
+	if (dep < 0)
+	{
+	    return -1;
+	}
+	deps.push_back(dep);
+    }
+    visiting.pop_back();
+
+    units.push_back(Unit{fileName, deps, Waiting});
+    index[name] = units.size() - 1;
+    return units.size() - 1;
+}
+
+bool UnitGraph::Ready(const Unit& unit) const
+{
+    for(auto d : unit.deps)
+    {
+	if (units[d].state != Done)
+	{
+	    return false;
+	}
+    }
+    return true;
+}
+
+// Wait for one compile to finish, returning its exit status.
+int UnitGraph::Wait(std::map<pid_t, int>& children)
+{
+    int status;
+    pid_t pid = waitpid(-1, &status, 0);
+    auto it = children.find(pid);
+    if (pid < 0 || it == children.end())
+    {
+	std::cerr << "Lost track of unit compiles" << std::endl;
+	children.clear();
+	return 1;
+    }
+    units[it->second].state = Done;
+    children.erase(it);
+    return (WIFEXITED(status) ? WEXITSTATUS(status) : 1);
+}
+
+int UnitGraph::Build(int jobs, std::function<int(const std::string&)> compileUnit)
+{
+    std::map<pid_t, int> children;
+    size_t done = 0;
+    int failed = 0;
+    while(done < units.size())
+    {
+	bool started = false;
+	for(size_t i = 0; i < units.size() && !failed; i++)
+	{
+	    Unit& u = units[i];
+	    if (u.state != Waiting || !Ready(u))
+	    {
+		continue;
+	    }
+	    // Checked only now, as compiling its dependencies may have changed it.
+	    if (UnitCache::IsUpToDate(u.fileName))
+	    {
+		u.state = Done;
+		done++;
+		started = true;
+		continue;
+	    }
+	    if (children.size() >= size_t(jobs))
+	    {
+		break;
+	    }
+	    if (verbosity)
+	    {
+		std::cerr << "Compiling unit " << u.fileName << std::endl;
+	    }
+	    std::cout.flush();
+	    pid_t pid = fork();
+	    if (pid < 0)
+	    {
+		std::cerr << "Could not start compile of " << u.fileName << std::endl;
+		failed = 1;
+		break;
+	    }
+	    if (pid == 0)
+	    {
+		exit(compileUnit(u.fileName));
+	    }
+	    children[pid] = i;
+	    u.state = Running;
+	    started = true;
+	}
+	if (children.empty())
+	{
+	    if (failed || !started)
+	    {
+		break;
+	    }
+	    continue;
+	}
+	if (int e = Wait(children))
+	{
+	    failed = e;
+	}
+	done++;
+    }
+    while(!children.empty())
+    {
+	Wait(children);
+    }
+    return failed;
+}
+
+int MakeUnits(const std::string& fileName, int jobs,
+	      std::function<int(const std::string&)> compileUnit)
+{
+    TIME_TRACE();
+    UnitGraph graph;
+    if (!graph.Scan(fileName))
+    {
+	return 1;
+    }
+    return graph.Build(std::max(jobs, 1), compileUnit);
+}
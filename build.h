@@ -0,0 +1,14 @@
+#ifndef BUILD_H
+#define BUILD_H
+
+#include <functional>
+#include <string>
+
+// Bring the units a program uses up to date for -make. The "uses" clauses are scanned
+// to find the units and their dependencies, and units that are not up to date in the
+// unit cache are compiled, dependencies first, up to jobs at a time in separate
+// processes. Returns non-zero on failure.
+int MakeUnits(const std::string& fileName, int jobs,
+	      std::function<int(const std::string&)> compileUnit);
+
+#endif
@@ -1,6 +1,7 @@
 #include "expr.h"
 #include "builtin.h"
 #include "options.h"
+#include "utils.h"
 #include <llvm/IR/DataLayout.h>
 #include <functional>
 
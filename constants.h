@@ -3,6 +3,7 @@
 
 // Need token for "location". 
 #include "token.h"
+#include "arena.h"
 
 class Constants
 {
@@ -23,6 +24,8 @@ public:
 	ConstDecl(ConstKind k, const Location& w)
 	    : kind(k), loc(w) {}
 	virtual ~ConstDecl() {}
+	static void* operator new(size_t size) { return Arena::Allocate(size, Arena::Const); }
+	static void operator delete(void*) {}
 	virtual Token Translate() const = 0;
 	ConstKind getKind() const { return kind; }
 	virtual void dump() const = 0;
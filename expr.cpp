@@ -3,6 +3,7 @@
 #include "builtin.h"
 #include "options.h"
 #include "trace.h"
+#include "binary.h"
 #include "types.h"
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/LLVMContext.h>
@@ -14,6 +15,7 @@
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/DataLayout.h>
 #include <llvm/IR/DIBuilder.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/Support/raw_os_ostream.h>
 
 #include <iostream>
@@ -25,15 +27,13 @@
 template<>
 void Stack<llvm::Value*>::dump(std::ostream& out) const
 {
-    int n = 0;
-    for(auto s : stack)
+    for(size_t n = 0; n < levels.size(); n++)
     {
 	out << "Level " << n << std::endl;
-	n++;
-	for(auto v : s)
+	for(auto v : GetLevelEntries(n))
 	{
-	    out << v.first << ": ";
-	    v.second->dump();
+	    out << SymbolName(v.name) << ": ";
+	    v.value->dump();
 	    out << std::endl;
 	}
     }
@@ -47,7 +47,10 @@ public:
     llvm::DIBuilder* builder;
     std::vector<llvm::DIScope*> lexicalBlocks;
     void EmitLocation(Location loc);
+    llvm::DIFile* GetFile(FileId id);
     ~DebugInfo();
+private:
+    std::vector<llvm::DIFile*> files;
 };
 
 class Label
@@ -81,6 +84,8 @@ static llvm::IRBuilder<> builder(theContext);
 static int errCnt;
 static std::vector<VTableAST*> vtableBackPatchList;
 static std::vector<FunctionAST*> unitInit;
+// The range error block of each function, see RangeErrorBlock.
+static std::map<llvm::Function*, llvm::BasicBlock*> rangeErrorBlocks;
 
 // Debug stack. We just use push_back and pop_back to make it like a stack.
 static std::vector<DebugInfo*> debugStack;
@@ -110,6 +115,21 @@ void DebugInfo::EmitLocation(Location loc)
     ::builder.SetCurrentDebugLocation(llvm::DebugLoc::get(loc.LineNumber(), loc.Column(), scope));
 }
 
+// One DIFile per source file, indexed by FileId.
+llvm::DIFile* DebugInfo::GetFile(FileId id)
+{
+    if (id >= files.size())
+    {
+	files.resize(id + 1);
+    }
+    if (!files[id])
+    {
+	// TODO: Fix path.
+	files[id] = builder->createFile(GetFileName(id), ".");
+    }
+    return files[id];
+}
+
 DebugInfo::~DebugInfo()
 {
     if (builder)
@@ -324,6 +344,54 @@ static llvm::Value* TempStringFromChar(llvm::Value* dest, ExprAST* rhs)
     return builder.CreateStore(rhs->CodeGen(), dest2);
 }
 
+// Pascal doesn't let a variable be accessed as another type, except through variant
+// records and type casts, so loads and stores of different scalar kinds can be
+// tagged as not aliasing each other. Subranges share the tag of their base type.
+static llvm::MDNode* TbaaTag(Types::TypeDecl* ty)
+{
+    const char* name;
+    switch(ty->Type())
+    {
+    case Types::TypeDecl::TK_Char:
+	name = "char";
+	break;
+    case Types::TypeDecl::TK_Integer:
+	name = "integer";
+	break;
+    case Types::TypeDecl::TK_LongInt:
+	name = "longint";
+	break;
+    case Types::TypeDecl::TK_Real:
+	name = "real";
+	break;
+    case Types::TypeDecl::TK_Boolean:
+	name = "boolean";
+	break;
+    case Types::TypeDecl::TK_Enum:
+	name = "enum";
+	break;
+    case Types::TypeDecl::TK_Pointer:
+	name = "pointer";
+	break;
+    default:
+	return 0;
+    }
+    llvm::MDBuilder mdb(theContext);
+    llvm::MDNode* scalar = mdb.createTBAAScalarTypeNode(name, mdb.createTBAARoot("Pascal TBAA"));
+    return mdb.createTBAAStructTagNode(scalar, scalar, 0);
+}
+
+static void AddTbaaTag(llvm::Instruction* inst, AddressableAST* e)
+{
+    if (e->StrictlyTyped())
+    {
+	if (llvm::MDNode* tag = TbaaTag(e->Type()))
+	{
+	    inst->setMetadata(llvm::LLVMContext::MD_tbaa, tag);
+	}
+    }
+}
+
 static llvm::Value* LoadOrMemcpy(llvm::Value* src, Types::TypeDecl* ty)
 {
     llvm::Value* dest = CreateTempAlloca(ty);
@@ -418,7 +486,9 @@ llvm::Value* AddressableAST::CodeGen()
 
     llvm::Value* v = Address();
     assert(v && "Expected to get an address");
-    return builder.CreateLoad(v, Name());
+    llvm::LoadInst* load = builder.CreateLoad(v, Name());
+    AddTbaaTag(load, this);
+    return load;
 }
 
 void VariableExprAST::DoDump(std::ostream& out) const
@@ -722,8 +792,10 @@ llvm::Value* BinaryExprAST::CallSetFunc(const std::string& name, bool resTyIsSet
 	return builder.CreateLoad(v, "set");
     }
 
-    llvm::Constant* f = GetFunction(Types::GetBooleanType(), { pty, pty, intTy }, "__Set" + name);
-    return builder.CreateCall(f, { lV, rV, setWords }, "calltmp");
+    // The runtime returns an int, declared as such so the call can be inlined.
+    llvm::Constant* f = GetFunction(Types::GetIntegerType(), { pty, pty, intTy }, "__Set" + name);
+    llvm::Value* res = builder.CreateCall(f, { lV, rV, setWords }, "calltmp");
+    return builder.CreateICmpNE(res, MakeIntegerConstant(0), "settest");
 }
 
 llvm::Value* MakeStringFromExpr(ExprAST* e, Types::TypeDecl* ty)
@@ -1235,6 +1307,8 @@ llvm::Value* CallExprAST::CodeGen()
 			    builder.CreateStore(i->CodeGen(), v);
 			}
 			argAttr.push_back(std::make_pair(index+1, llvm::Attribute::ByVal));
+			argAttr.push_back(std::make_pair(index+1, llvm::Attribute::NoAlias));
+			argAttr.push_back(std::make_pair(index+1, llvm::Attribute::NoCapture));
 		    }
 		    else
 		    {
@@ -1341,9 +1415,12 @@ llvm::Function* PrototypeAST::Create(const std::string& namePrefix)
 	if (i.IsRef() || i.Type()->IsCompound() )
 	{
 	    argTy = llvm::PointerType::getUnqual(argTy);
+	    // A value parameter is the callee's own copy, so nothing else refers to it.
 	    if (!i.IsRef())
 	    {
 		argAttr.push_back(std::make_pair(index, llvm::Attribute::ByVal));
+		argAttr.push_back(std::make_pair(index, llvm::Attribute::NoAlias));
+		argAttr.push_back(std::make_pair(index, llvm::Attribute::NoCapture));
 	    }
 	}
 
@@ -1388,6 +1465,14 @@ llvm::Function* PrototypeAST::Create(const std::string& namePrefix)
     }
     // TODO: Allow this to be disabled.
     llvmFunc->addFnAttr("no-frame-pointer-elim", "true");
+    if (!TargetCPU().empty())
+    {
+	llvmFunc->addFnAttr("target-cpu", TargetCPU());
+    }
+    if (!TargetFeatures().empty())
+    {
+	llvmFunc->addFnAttr("target-features", TargetFeatures());
+    }
 
     return llvmFunc;
 }
@@ -1630,7 +1715,7 @@ llvm::Function* FunctionAST::CodeGen(const std::string& namePrefix)
     {
 	DebugInfo& di = GetDebugInfo();
 	Location loc = body->Loc();
-	llvm::DIFile* unit = di.builder->createFile(di.cu->getFilename(), di.cu->getDirectory());
+	llvm::DIFile* unit = loc.File() ? di.GetFile(loc.File()) : di.cu->getFile();
 	llvm::DIScope* fnContext = unit;
 	llvm::DISubroutineType* st = CreateFunctionType(di, proto);
 	std::string name = proto->Name();
@@ -1729,7 +1814,7 @@ Types::TypeDecl* FunctionAST::ClosureType()
 	std::vector<Types::FieldDecl*> vf;
 	for(auto u : usedVariables)
 	{
-	    Types::TypeDecl* ty = new Types::PointerDecl(u.Type());
+	    Types::TypeDecl* ty = Types::MakePointerDecl(u.Type());
 	    vf.push_back(new Types::FieldDecl(u.Name(), ty, false));
 	}
 	closureType = new Types::RecordDecl(vf, 0);
@@ -1861,7 +1946,7 @@ llvm::Value* AssignExprAST::CodeGen()
 
     if (llvm::Value* v = rhs->CodeGen())
     {
-	builder.CreateStore(v, dest);
+	AddTbaaTag(builder.CreateStore(v, dest), lhsv);
 	return v;
     }
     return ErrorV(this, "Could not produce expression for assignment");
@@ -1980,6 +2065,11 @@ void ForExprAST::accept(ASTVisitor& v)
     v.visit(this);
 }
 
+// The control variable can't be changed in the body, so the loop is counted by an
+// induction variable of its own, from zero up to the distance from start to end, and
+// the control variable is set from it at the start of each iteration. Comparing
+// with the last value, rather than one past it, works for loops over the whole range
+// of the type.
 llvm::Value* ForExprAST::CodeGen()
 {
     TRACE();
@@ -1991,77 +2081,59 @@ llvm::Value* ForExprAST::CodeGen()
 
     llvm::Value* startV = start->CodeGen();
     assert(startV && "Expected start to generate code");
-
-    llvm::Value* stepVal = MakeConstant((stepDown)?-1:1, start->Type());
     llvm::Value* endV = end->CodeGen();
     assert(endV && "Expected end to generate code");
 
     builder.CreateStore(startV, var);
 
-    llvm::BasicBlock* loopBB = llvm::BasicBlock::Create(theContext, "loop", theFunction);
-    llvm::BasicBlock* afterBB = llvm::BasicBlock::Create(theContext, "afterloop", theFunction);
-
-    llvm::Value* curVar = builder.CreateLoad(var, variable->Name());
-    llvm::Value* endCond;
-
+    llvm::Value* runCond;
     if (start->Type()->IsUnsigned())
     {
 	if (stepDown)
 	{
-	    endCond = builder.CreateICmpUGE(curVar, endV, "loopcond");
+	    runCond = builder.CreateICmpUGE(startV, endV, "loopcond");
 	}
 	else
 	{
-	    endCond = builder.CreateICmpULE(curVar, endV, "loopcond");
+	    runCond = builder.CreateICmpULE(startV, endV, "loopcond");
 	}
     }
     else
     {
 	if (stepDown)
 	{
-	    endCond = builder.CreateICmpSGE(curVar, endV, "loopcond");
+	    runCond = builder.CreateICmpSGE(startV, endV, "loopcond");
 	}
 	else
 	{
-	    endCond = builder.CreateICmpSLE(curVar, endV, "loopcond");
+	    runCond = builder.CreateICmpSLE(startV, endV, "loopcond");
 	}
     }
-    builder.CreateSub(endV, stepVal);
-    builder.CreateCondBr(endCond, loopBB, afterBB);
+    llvm::Value* last = (stepDown ? builder.CreateSub(startV, endV, "last") :
+			 builder.CreateSub(endV, startV, "last"));
+
+    llvm::BasicBlock* preBB = builder.GetInsertBlock();
+    llvm::BasicBlock* loopBB = llvm::BasicBlock::Create(theContext, "loop", theFunction);
+    llvm::BasicBlock* afterBB = llvm::BasicBlock::Create(theContext, "afterloop", theFunction);
+    builder.CreateCondBr(runCond, loopBB, afterBB);
 
     builder.SetInsertPoint(loopBB);
+    llvm::PHINode* iv = builder.CreatePHI(startV->getType(), 2, "iv");
+    iv->addIncoming(MakeConstant(0, start->Type()), preBB);
+    llvm::Value* curVar = (stepDown ? builder.CreateSub(startV, iv, variable->Name()) :
+			   builder.CreateAdd(startV, iv, variable->Name()));
+    builder.CreateStore(curVar, var);
+
     if (!body->CodeGen())
     {
 	return 0;
     }
-    curVar = builder.CreateLoad(var, variable->Name());
-    if (start->Type()->IsUnsigned())
-    {
-	if (stepDown)
-	{
-	    endCond = builder.CreateICmpUGT(curVar, endV, "loopcond");
-	}
-	else
-	{
-	    endCond = builder.CreateICmpULT(curVar, endV, "loopcond");
-	}
-    }
-    else
-    {
-	if (stepDown)
-	{
-	    endCond = builder.CreateICmpSGT(curVar, endV, "loopcond");
-	}
-	else
-	{
-	    endCond = builder.CreateICmpSLT(curVar, endV, "loopcond");
-	}
-    }
-    curVar = builder.CreateAdd(curVar, stepVal, "nextvar");
-    builder.CreateStore(curVar, var);
+    llvm::Value* endCond = builder.CreateICmpEQ(iv, last, "loopcond");
+    llvm::Value* nextIV = builder.CreateAdd(iv, MakeConstant(1, start->Type()), "nextiv");
+    iv->addIncoming(nextIV, builder.GetInsertBlock());
 
     BasicDebugInfo(this);
-    builder.CreateCondBr(endCond, loopBB, afterBB);
+    builder.CreateCondBr(endCond, afterBB, loopBB);
 
     builder.SetInsertPoint(afterBB);
 
@@ -2578,15 +2650,25 @@ llvm::Value* VarDeclAST::CodeGen()
 	    llvm::GlobalValue::LinkageTypes linkage = (var.IsExternal()?
 						       llvm::GlobalValue::ExternalLinkage:
 						       llvm::Function::InternalLinkage);
+	    std::string name = var.Name();
+	    if (!unitName.empty())
+	    {
+		linkage = llvm::GlobalValue::ExternalLinkage;
+		name = unitName + "." + name;
+	    }
+	    if (isImported)
+	    {
+		init = 0;
+	    }
 
 	    llvm::GlobalVariable* gv = new llvm::GlobalVariable(*theModule, ty, false, linkage,
-								init, var.Name());
+								init, name);
 	    const llvm::DataLayout dl(theModule);
 	    size_t al = dl.getPrefTypeAlignment(ty);
 	    al = std::max(size_t(4), al);
 	    gv->setAlignment(al);
 	    v = gv;
-	    if (debugInfo)
+	    if (debugInfo && !isImported)
 	    {
 		DebugInfo& di = GetDebugInfo();
 		llvm::DIType* debugType = var.Type()->DebugType(di.builder);
@@ -2663,7 +2745,11 @@ void LabelExprAST::DoDump(std::ostream& out) const
 	{
 	    out << ", ";
 	}
-	out << l;
+	out << l.first;
+	if (l.second != l.first)
+	{
+	    out << ".." << l.second;
+	}
 	first = false;
     }
     out << ": ";
@@ -2677,7 +2763,7 @@ llvm::Value* LabelExprAST::CodeGen()
     BasicDebugInfo(this);
 
     assert(!stmt && "Expected no statement for 'goto' label expression");
-    llvm::BasicBlock* labelBB = CreateGotoTarget(labelValues[0]);
+    llvm::BasicBlock* labelBB = CreateGotoTarget(labelValues[0].first);
     // Make LLVM-IR valid by jumping to the neew block!
     llvm::Value* v = builder.CreateBr(labelBB);
     builder.SetInsertPoint(labelBB);
@@ -2685,7 +2771,17 @@ llvm::Value* LabelExprAST::CodeGen()
     return v;
 }
 
-llvm::Value* LabelExprAST::CodeGen(llvm::SwitchInst* sw, llvm::BasicBlock* afterBB, llvm::Type* ty)
+// Ranges with more values than this are not put in the switch one value at a time,
+// but found by CaseExprAST with a binary search over the ranges.
+static const int64_t maxSwitchRange = 64;
+
+static bool IsWideRange(const LabelExprAST::Range& r)
+{
+    return int64_t(r.second) - r.first + 1 > maxSwitchRange;
+}
+
+llvm::BasicBlock* LabelExprAST::CodeGen(llvm::SwitchInst* sw, llvm::BasicBlock* afterBB,
+					llvm::Type* ty)
 {
     TRACE();
 
@@ -2698,10 +2794,16 @@ llvm::Value* LabelExprAST::CodeGen(llvm::SwitchInst* sw, llvm::BasicBlock* after
     builder.SetInsertPoint(caseBB);
     stmt->CodeGen();
     builder.CreateBr(afterBB);
+    llvm::IntegerType* intTy = llvm::dyn_cast<llvm::IntegerType>(ty);
     for(auto l : labelValues)
     {
-	llvm::IntegerType* intTy = llvm::dyn_cast<llvm::IntegerType>(ty);
-	sw->addCase(llvm::ConstantInt::get(intTy, l), caseBB);
+	if (!IsWideRange(l))
+	{
+	    for(int64_t i = l.first; i <= l.second; i++)
+	    {
+		sw->addCase(llvm::ConstantInt::get(intTy, i), caseBB);
+	    }
+	}
     }
     return caseBB;
 }
@@ -2744,6 +2846,49 @@ void CaseExprAST::accept(ASTVisitor& v)
     }
 }
 
+struct CaseRange
+{
+    LabelExprAST::Range range;
+    llvm::BasicBlock*   caseBB;
+};
+
+// Binary search for v in the sorted ranges, going to defaultBB if it is in none.
+// Returns the block to start the search at.
+static llvm::BasicBlock* RangeSearch(const std::vector<CaseRange>& ranges, size_t begin,
+				     size_t end, llvm::Value* v, bool isUnsigned,
+				     llvm::BasicBlock* defaultBB)
+{
+    if (begin == end)
+    {
+	return defaultBB;
+    }
+    size_t mid = (begin + end) / 2;
+    llvm::BasicBlock* below = RangeSearch(ranges, begin, mid, v, isUnsigned, defaultBB);
+    llvm::BasicBlock* above = RangeSearch(ranges, mid + 1, end, v, isUnsigned, defaultBB);
+
+    llvm::Function* theFunction = defaultBB->getParent();
+    llvm::BasicBlock* testBB = llvm::BasicBlock::Create(theContext, "range", theFunction);
+    llvm::BasicBlock* outsideBB = llvm::BasicBlock::Create(theContext, "outside", theFunction);
+    llvm::IntegerType* intTy = llvm::dyn_cast<llvm::IntegerType>(v->getType());
+    const LabelExprAST::Range& r = ranges[mid].range;
+    llvm::Constant* low = llvm::ConstantInt::get(intTy, r.first);
+
+    // In range if v - low <= high - low, unsigned.
+    builder.SetInsertPoint(testBB);
+    llvm::Value* offset = builder.CreateSub(v, low);
+    llvm::Value* width = llvm::ConstantInt::get(intTy, int64_t(r.second) - r.first);
+    llvm::Value* inside = builder.CreateICmpULE(offset, width);
+    builder.CreateCondBr(inside, ranges[mid].caseBB, outsideBB);
+
+    builder.SetInsertPoint(outsideBB);
+    llvm::Value* isBelow = (isUnsigned ? builder.CreateICmpULT(v, low) : builder.CreateICmpSLT(v, low));
+    builder.CreateCondBr(isBelow, below, above);
+    return testBB;
+}
+
+// Single values and small ranges go in a switch, which the code generator turns into
+// jump tables, bit tests or compares. Wide ranges (e.g. 1..100000) would make huge
+// switches, so are found with a binary search from the switch's default instead.
 llvm::Value* CaseExprAST::CodeGen()
 {
     TRACE();
@@ -2757,6 +2902,20 @@ llvm::Value* CaseExprAST::CodeGen()
 	return ErrorV(this, "Case selection must be integral type");
     }
 
+    std::vector<LabelExprAST::Range> all;
+    for(auto ll : labels)
+    {
+	all.insert(all.end(), ll->LabelValues().begin(), ll->LabelValues().end());
+    }
+    std::sort(all.begin(), all.end());
+    for(size_t i = 1; i < all.size(); i++)
+    {
+	if (all[i].first <= all[i-1].second)
+	{
+	    return ErrorV(this, "Duplicate case label value " + std::to_string(all[i].first));
+	}
+    }
+
     llvm::Function* theFunction = builder.GetInsertBlock()->getParent();
     llvm::BasicBlock* afterBB = llvm::BasicBlock::Create(theContext, "after", theFunction);
     llvm::BasicBlock* defaultBB = afterBB;
@@ -2766,9 +2925,26 @@ llvm::Value* CaseExprAST::CodeGen()
 	
     }	
     llvm::SwitchInst* sw = builder.CreateSwitch(v, defaultBB, labels.size());
+    std::vector<CaseRange> wide;
     for(auto ll : labels)
     {
-	ll->CodeGen(sw, afterBB, ty);
+	llvm::BasicBlock* caseBB = ll->CodeGen(sw, afterBB, ty);
+	for(auto l : ll->LabelValues())
+	{
+	    if (IsWideRange(l))
+	    {
+		wide.push_back(CaseRange{l, caseBB});
+	    }
+	}
+    }
+    if (!wide.empty())
+    {
+	std::sort(wide.begin(), wide.end(), [](const CaseRange& a, const CaseRange& b)
+		  {
+		      return a.range.first < b.range.first;
+		  });
+	sw->setDefaultDest(RangeSearch(wide, 0, wide.size(), v, expr->Type()->IsUnsigned(),
+				       defaultBB));
     }
 
     if (otherwise)
@@ -3067,6 +3243,57 @@ void RangeCheckAST::DoDump(std::ostream& out) const
     out << "]";
 }
 
+// The name of a source file as a C string. There is one global per file in the
+// module, rather than one per range check.
+static llvm::Constant* FileNameString(FileId id)
+{
+    std::string name = ".filename." + std::to_string(id);
+    llvm::GlobalVariable* gv = theModule->getNamedGlobal(name);
+    if (!gv)
+    {
+	gv = builder.CreateGlobalString(GetFileName(id), name);
+    }
+    llvm::Type* ty = llvm::PointerType::getUnqual(Types::GetCharType()->LlvmType());
+    return llvm::ConstantExpr::getPointerCast(gv, ty);
+}
+
+// All the range checks in a function branch to one block that reports the error,
+// with the details of the failed check passed in through phi nodes. It is cold and
+// never returns, so it stays out of the way of the code that does the work.
+static llvm::BasicBlock* RangeErrorBlock(llvm::Function* theFunction)
+{
+    llvm::BasicBlock*& oorBlock = rangeErrorBlocks[theFunction];
+    if (oorBlock)
+    {
+	return oorBlock;
+    }
+
+    oorBlock = llvm::BasicBlock::Create(theContext, "out_of_range", theFunction);
+    llvm::IRBuilder<> oorBuilder(oorBlock);
+    llvm::Type* intTy = Types::GetIntegerType()->LlvmType();
+    std::vector<llvm::Type*> argTypes = { llvm::PointerType::getUnqual(Types::GetCharType()->LlvmType()),
+					  intTy,
+					  intTy,
+					  intTy,
+					  intTy };
+    std::vector<llvm::Value*> args;
+    for(auto ty : argTypes)
+    {
+	args.push_back(oorBuilder.CreatePHI(ty, 2));
+    }
+
+    llvm::Constant* fn = GetFunction(Types::GetVoidPtrType(), argTypes, "range_error");
+    if (llvm::Function* f = llvm::dyn_cast<llvm::Function>(fn))
+    {
+	f->setDoesNotReturn();
+	f->addFnAttr(llvm::Attribute::Cold);
+    }
+    llvm::CallInst* call = oorBuilder.CreateCall(fn, args, "");
+    call->setDoesNotReturn();
+    oorBuilder.CreateUnreachable();
+    return oorBlock;
+}
+
 llvm::Value* RangeCheckAST::CodeGen()
 {
     TRACE();
@@ -3099,28 +3326,21 @@ llvm::Value* RangeCheckAST::CodeGen()
     int end = range->GetRange()->Size();
     llvm::Value* cmp = builder.CreateICmpUGE(index, MakeIntegerConstant(end), "rangecheck");
     llvm::Function* theFunction = builder.GetInsertBlock()->getParent();
-    llvm::BasicBlock* oorBlock = llvm::BasicBlock::Create(theContext, "out_of_range");
+    llvm::BasicBlock* oorBlock = RangeErrorBlock(theFunction);
     llvm::BasicBlock* contBlock = llvm::BasicBlock::Create(theContext, "continue",
 							   theFunction);
-    builder.CreateCondBr(cmp, oorBlock, contBlock);
-
-    theFunction->getBasicBlockList().push_back(oorBlock);
-    builder.SetInsertPoint(oorBlock);
-    std::vector<llvm::Value*> args = { builder.CreateGlobalStringPtr(Loc().FileName()),
+    std::vector<llvm::Value*> args = { FileNameString(Loc().File()),
 				       MakeIntegerConstant(Loc().LineNumber()),
 				       MakeIntegerConstant(start),
 				       MakeIntegerConstant(end),
 				       orig_index };
-    std::vector<llvm::Type*> argTypes = { llvm::PointerType::getUnqual(Types::GetCharType()->LlvmType()),
-					  intTy,
-					  intTy,
-					  intTy,
-					  intTy };
-
-    llvm::Constant* fn = GetFunction(Types::GetVoidPtrType(), argTypes, "range_error");
-
-    builder.CreateCall(fn, args, "");
-    builder.CreateUnreachable();
+    llvm::BasicBlock::iterator phi = oorBlock->begin();
+    for(auto a : args)
+    {
+	llvm::cast<llvm::PHINode>(phi++)->addIncoming(a, builder.GetInsertBlock());
+    }
+    llvm::MDNode* weights = llvm::MDBuilder(theContext).createBranchWeights(1, 2000);
+    builder.CreateCondBr(cmp, oorBlock, contBlock, weights);
 
     builder.SetInsertPoint(contBlock);
     return index;
@@ -3442,9 +3662,9 @@ llvm::Value* UnitAST::CodeGen()
     {
 	Location loc = Loc();
 
-	// TODO: Fix path and add flags.
+	// TODO: Add flags.
 	di.builder = new llvm::DIBuilder(*theModule, true);
-	llvm::DIFile* file = di.builder->createFile(loc.FileName(), ".");
+	llvm::DIFile* file = di.GetFile(loc.File());
 	di.cu = di.builder->createCompileUnit(llvm::dwarf::DW_LANG_Pascal83, file,
 					      "Lacsap", optimization >= O1, "", 0);
 
@@ -3559,11 +3779,31 @@ static void BuildUnitInitList()
     assert(unitInitList && "Unit Initializer List not built correctly?");
 }
 
-void BackPatch()
+void BackPatch(bool isProgram)
 {
     for(auto v : vtableBackPatchList)
     {
 	v->Fixup();
     }
-    BuildUnitInitList();
+    vtableBackPatchList.clear();
+    // A separately compiled unit gets its init function called from the program's list.
+    if (isProgram)
+    {
+	BuildUnitInitList();
+    }
+    unitInit.clear();
+}
+
+// The code generator's state refers to the module it was generating, so start from
+// nothing for the next one, e.g. a unit compiled after the program that used it.
+void ResetCodeGen()
+{
+    variables = VarStack();
+    labels = LabelStack();
+    vtableBackPatchList.clear();
+    unitInit.clear();
+    rangeErrorBlocks.clear();
+    debugStack.clear();
+    builder.ClearInsertionPoint();
+    errCnt = 0;
 }
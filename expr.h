@@ -7,6 +7,7 @@
 #include "visitor.h"
 #include "stack.h"
 #include "builtin.h"
+#include "arena.h"
 #include <llvm/IR/Value.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/Module.h>
@@ -78,6 +79,8 @@ public:
     ExprAST(const Location &w, ExprKind k, Types::TypeDecl* ty)
 	: loc(w), kind(k), type(ty) {}
     virtual ~ExprAST() {}
+    static void* operator new(size_t size) { return Arena::Allocate(size, Arena::AST); }
+    static void operator delete(void*) {}
     void dump(std::ostream& out) const;
     void dump() const;
     virtual void DoDump(std::ostream& out) const
@@ -142,7 +145,7 @@ class NilExprAST : public ExprAST
 {
 public:
     NilExprAST(const Location& w)
-	: ExprAST(w, EK_NilExpr, new Types::PointerDecl(Types::GetVoidType())) {}
+	: ExprAST(w, EK_NilExpr, Types::MakePointerDecl(Types::GetVoidType())) {}
     void DoDump(std::ostream& out) const override;
     llvm::Value* CodeGen() override;
     static bool classof(const ExprAST* e) { return e->getKind() == EK_NilExpr; }
@@ -156,6 +159,9 @@ public:
     virtual llvm::Value* Address() { assert(0 && "Needs implementing"); return 0; }
     llvm::Value* CodeGen() override;
     virtual const std::string Name() const { return ""; }
+    // False if the memory may also be accessed as another type, through a variant
+    // record or a type cast, so type based alias analysis can't be used on it.
+    virtual bool StrictlyTyped() const { return true; }
     static bool classof(const ExprAST* e)
     {
 	return e->getKind() >= EK_AddressableExpr && e->getKind() <= EK_LastAddressable;
@@ -219,6 +225,7 @@ public:
     void DoDump(std::ostream& out) const override;
     /* Don't need CodeGen, just calculate address and use parent CodeGen */
     llvm::Value* Address() override;
+    bool StrictlyTyped() const override { return expr->StrictlyTyped(); }
     static bool classof(const ExprAST* e) { return e->getKind() == EK_ArrayExpr; }
     void accept(ASTVisitor& v) override;
 private:
@@ -235,6 +242,13 @@ public:
 	: VariableExprAST(w, EK_PointerExpr, p, ty), pointer(p) {}
     void DoDump(std::ostream& out) const override;
     llvm::Value* Address() override;
+    // The pointed-to memory is only strictly typed if the pointer itself is, not
+    // read from a variant field or made by a type cast.
+    bool StrictlyTyped() const override
+    {
+	const AddressableAST* a = llvm::dyn_cast<AddressableAST>(pointer);
+	return a && a->StrictlyTyped();
+    }
     static bool classof(const ExprAST* e) { return e->getKind() == EK_PointerExpr; }
     void accept(ASTVisitor& v) override;
 private:
@@ -261,6 +275,7 @@ public:
 	: VariableExprAST(w, EK_FieldExpr, base, ty), expr(base), element(elem) {}
     void DoDump(std::ostream& out) const override;
     llvm::Value* Address() override;
+    bool StrictlyTyped() const override { return expr->StrictlyTyped(); }
     static bool classof(const ExprAST* e) { return e->getKind() == EK_FieldExpr; }
     void accept(ASTVisitor& v) override;
 private:
@@ -275,6 +290,7 @@ public:
 	: VariableExprAST(w, EK_VariantFieldExpr, base, ty), expr(base), element(elem) {}
     void DoDump(std::ostream& out) const override;
     llvm::Value* Address() override;
+    bool StrictlyTyped() const override { return false; }
     static bool classof(const ExprAST* e) { return e->getKind() == EK_VariantFieldExpr; }
 private:
     VariableExprAST* expr;
@@ -378,16 +394,22 @@ class VarDeclAST : public ExprAST
 {
 public:
     VarDeclAST(const Location& w, std::vector<VarDef> v)
-	: ExprAST(w, EK_VarDecl), vars(v), func(0) {}
+	: ExprAST(w, EK_VarDecl), vars(v), func(0), isImported(false) {}
     void DoDump(std::ostream& out) const override;
     llvm::Value* CodeGen() override;
     void SetFunction(FunctionAST* f) { func = f; }
     FunctionAST* Function() { return func; }
+    // Interface variables of a precompiled unit are external, named "unit.var".
+    void SetUnit(const std::string& unit) { unitName = unit; }
+    // Only declared, the variables are defined in another object.
+    void SetImported() { isImported = true; }
     static bool classof(const ExprAST* e) { return e->getKind() == EK_VarDecl; }
     const std::vector<VarDef>& Vars() { return vars; }
 private:
     std::vector<VarDef> vars;
     FunctionAST* func;
+    std::string unitName;
+    bool isImported;
 };
 
 class PrototypeAST : public ExprAST
@@ -622,16 +644,19 @@ private:
 class LabelExprAST : public ExprAST
 {
 public:
-    LabelExprAST(const Location& w, const std::vector<int>& lab, ExprAST* st)
+    // Lowest and highest value (inclusive) of a case label.
+    typedef std::pair<int, int> Range;
+    LabelExprAST(const Location& w, const std::vector<Range>& lab, ExprAST* st)
 	: ExprAST(w, EK_LabelExpr), labelValues(lab),stmt(st) {}
     void DoDump(std::ostream& out) const override;
     llvm::Value* CodeGen() override;
-    llvm::Value* CodeGen(llvm::SwitchInst* inst, llvm::BasicBlock* afterBB, llvm::Type* ty);
+    llvm::BasicBlock* CodeGen(llvm::SwitchInst* inst, llvm::BasicBlock* afterBB, llvm::Type* ty);
+    const std::vector<Range>& LabelValues() const { return labelValues; }
     static bool classof(const ExprAST* e) { return e->getKind() == EK_LabelExpr; }
     void accept(ASTVisitor& v) override;
 private:
-    std::vector<int> labelValues;
-    ExprAST*         stmt;
+    std::vector<Range> labelValues;
+    ExprAST*           stmt;
 };
 
 class CaseExprAST : public ExprAST
@@ -664,6 +689,7 @@ private:
 
 class RangeReduceAST : public ExprAST
 {
+    friend class TypeCheckVisitor;
 public:
     RangeReduceAST(ExprAST* e, Types::RangeDecl* r)
 	: ExprAST(e->Loc(), EK_RangeReduceExpr, e->Type()), expr(e), range(r) {}
@@ -699,6 +725,7 @@ public:
     void DoDump(std::ostream& out) const override;
     llvm::Value* CodeGen() override;
     llvm::Value* Address() override;
+    bool StrictlyTyped() const override { return false; }
     ExprAST* Expr() { return expr; }
     static bool classof(const ExprAST* e) { return e->getKind() == EK_TypeCastExpr; }
 private:
@@ -808,7 +835,8 @@ llvm::Constant* MakeBooleanConstant(int val);
 llvm::Constant* MakeConstant(uint64_t val, Types::TypeDecl* ty);
 llvm::Value* MakeAddressable(ExprAST* e);
 llvm::Value* MakeStringFromExpr(ExprAST* e, Types::TypeDecl* ty);
-void BackPatch();
+void BackPatch(bool isProgram);
+void ResetCodeGen();
 llvm::Constant* GetFunction(llvm::Type* resTy, const std::vector<llvm::Type*>& args,
 			    const std::string&name);
 llvm::Constant* GetFunction(Types::TypeDecl* res, const std::vector<llvm::Type*>& args,
@@ -0,0 +1,216 @@
+#include "jit.h"
+#include "binary.h"
+#include "options.h"
+#include "trace.h"
+#include <llvm/ExecutionEngine/JITSymbol.h>
+#include <llvm/ExecutionEngine/RTDyldMemoryManager.h>
+#include <llvm/ExecutionEngine/SectionMemoryManager.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/Orc/IRCompileLayer.h>
+#include <llvm/ExecutionEngine/Orc/LambdaResolver.h>
+#include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
+#include <llvm/IR/Mangler.h>
+#include <llvm/Object/Archive.h>
+#include <llvm/Object/ObjectFile.h>
+#include <llvm/Support/DynamicLibrary.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <iostream>
+
+class PascalJIT
+{
+public:
+    typedef llvm::orc::RTDyldObjectLinkingLayer ObjectLayer;
+    typedef llvm::orc::IRCompileLayer<ObjectLayer, llvm::orc::SimpleCompiler> CompileLayer;
+
+    PascalJIT(llvm::TargetMachine& tm);
+    bool AddModule(std::unique_ptr<llvm::Module> module);
+    bool AddObjectFile(const std::string& fileName);
+    bool AddArchive(const std::string& fileName);
+    llvm::JITTargetAddress FindSymbol(const std::string& name);
+
+private:
+    bool AddObject(std::unique_ptr<llvm::MemoryBuffer> buffer);
+
+private:
+    llvm::DataLayout                          dl;
+    ObjectLayer                               objectLayer;
+    CompileLayer                              compileLayer;
+    std::shared_ptr<llvm::JITSymbolResolver> resolver;
+};
+
+// Symbols are looked for in the JIT first (program and runtime), then in the
+// compiler's own process (the C library).
+PascalJIT::PascalJIT(llvm::TargetMachine& tm)
+    : dl(tm.createDataLayout()),
+      objectLayer([]() { return std::make_shared<llvm::SectionMemoryManager>(); }),
+      compileLayer(objectLayer, llvm::orc::SimpleCompiler(tm))
+{
+    resolver = llvm::orc::createLambdaResolver(
+	[this](const std::string& name)
+	{
+	    return compileLayer.findSymbol(name, false);
+	},
+	[](const std::string& name)
+	{
+	    if (auto addr = llvm::RTDyldMemoryManager::getSymbolAddressInProcess(name))
+	    {
+		return llvm::JITSymbol(addr, llvm::JITSymbolFlags::Exported);
+	    }
+	    return llvm::JITSymbol(nullptr);
+	});
+    llvm::sys::DynamicLibrary::LoadLibraryPermanently(nullptr);
+}
+
+bool PascalJIT::AddModule(std::unique_ptr<llvm::Module> module)
+{
+    auto handle = compileLayer.addModule(std::move(module), resolver);
+    if (!handle)
+    {
+	llvm::logAllUnhandledErrors(handle.takeError(), llvm::errs(), "JIT: ");
+	return false;
+    }
+    return true;
+}
+
+bool PascalJIT::AddObject(std::unique_ptr<llvm::MemoryBuffer> buffer)
+{
+    auto obj = llvm::object::ObjectFile::createObjectFile(buffer->getMemBufferRef());
+    if (!obj)
+    {
+	llvm::logAllUnhandledErrors(obj.takeError(), llvm::errs(),
+				    buffer->getBufferIdentifier() + ": ");
+	return false;
+    }
+    typedef llvm::object::OwningBinary<llvm::object::ObjectFile> OwningObject;
+    auto handle = objectLayer.addObject(std::make_shared<OwningObject>(std::move(*obj),
+								      std::move(buffer)),
+					resolver);
+    if (!handle)
+    {
+	llvm::logAllUnhandledErrors(handle.takeError(), llvm::errs(), "JIT: ");
+	return false;
+    }
+    return true;
+}
+
+bool PascalJIT::AddObjectFile(const std::string& fileName)
+{
+    auto buffer = llvm::MemoryBuffer::getFile(fileName);
+    if (!buffer)
+    {
+	std::cerr << "Could not open " << fileName << std::endl;
+	return false;
+    }
+    return AddObject(std::move(*buffer));
+}
+
+// Add each object of a static library, as the linker would with --whole-archive.
+bool PascalJIT::AddArchive(const std::string& fileName)
+{
+    auto buffer = llvm::MemoryBuffer::getFile(fileName);
+    if (!buffer)
+    {
+	std::cerr << "Could not open " << fileName << std::endl;
+	return false;
+    }
+    llvm::Error err = llvm::Error::success();
+    llvm::object::Archive archive(buffer.get()->getMemBufferRef(), err);
+    if (err)
+    {
+	llvm::logAllUnhandledErrors(std::move(err), llvm::errs(), fileName + ": ");
+	return false;
+    }
+    for(auto& child : archive.children(err))
+    {
+	auto childBuffer = child.getMemoryBufferRef();
+	if (!childBuffer)
+	{
+	    llvm::logAllUnhandledErrors(childBuffer.takeError(), llvm::errs(), fileName + ": ");
+	    return false;
+	}
+	if (!AddObject(llvm::MemoryBuffer::getMemBufferCopy(childBuffer->getBuffer(),
+							    childBuffer->getBufferIdentifier())))
+	{
+	    return false;
+	}
+    }
+    if (err)
+    {
+	llvm::logAllUnhandledErrors(std::move(err), llvm::errs(), fileName + ": ");
+	return false;
+    }
+    return true;
+}
+
+llvm::JITTargetAddress PascalJIT::FindSymbol(const std::string& name)
+{
+    std::string mangled;
+    llvm::raw_string_ostream os(mangled);
+    llvm::Mangler::getNameWithPrefix(os, name, dl);
+    llvm::JITSymbol sym = compileLayer.findSymbol(os.str(), false);
+    if (!sym)
+    {
+	return 0;
+    }
+    auto addr = sym.getAddress();
+    if (!addr)
+    {
+	llvm::consumeError(addr.takeError());
+	return 0;
+    }
+    return *addr;
+}
+
+int RunProgram(llvm::Module* module, const std::vector<std::string>& objects,
+	       const std::vector<std::string>& args, std::chrono::steady_clock::time_point start)
+{
+    std::unique_ptr<llvm::Module> owned(module);
+    if (model == m32)
+    {
+	std::cerr << "Can't run 32-bit code in the compiler" << std::endl;
+	return -1;
+    }
+    std::unique_ptr<llvm::TargetMachine> tm(CreateTargetMachine(module->getTargetTriple(),
+								llvm::Reloc::PIC_));
+    if (!tm)
+    {
+	return -1;
+    }
+
+    PascalJIT jit(*tm);
+    if (!jit.AddArchive(libpath + "/libruntime.a") || !jit.AddModule(std::move(owned)))
+    {
+	return -1;
+    }
+    for(auto& o : objects)
+    {
+	if (!jit.AddObjectFile(o))
+	{
+	    return -1;
+	}
+    }
+
+    // The runtime's main sets up files and units, then calls __PascalMain.
+    typedef int (MainFunc)(int, char**);
+    MainFunc* mainFunc = reinterpret_cast<MainFunc*>(jit.FindSymbol("main"));
+    if (!mainFunc)
+    {
+	std::cerr << "Could not find main in the runtime" << std::endl;
+	return -1;
+    }
+    std::vector<char*> argv;
+    for(auto& a : args)
+    {
+	argv.push_back(const_cast<char*>(a.c_str()));
+    }
+    argv.push_back(0);
+
+    if (timetrace)
+    {
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	std::cerr << "Compile to first instruction: " << elapsed.count() << " ms" << std::endl;
+    }
+    std::cout.flush();
+    return mainFunc(args.size(), argv.data());
+}
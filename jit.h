@@ -0,0 +1,17 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <llvm/IR/Module.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Run the program in the module in-process with an ORC JIT, without writing or
+// linking an executable. The objects (of precompiled units) and those of the runtime
+// library are loaded into the JIT as well, and the runtime's main is called with
+// args, so files, units and ParamStr are set up as for a linked program. Takes ownership of the module.
+// Returns the program's exit code, or -1 if it could not be run.
+int RunProgram(llvm::Module* module, const std::vector<std::string>& objects,
+	       const std::vector<std::string>& args, std::chrono::steady_clock::time_point start);
+
+#endif
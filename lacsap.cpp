@@ -8,18 +8,32 @@
 #include "trace.h"
 #include "builtin.h"
 #include "callgraph.h"
+#include "arena.h"
+#include "utils.h"
+#include "unitcache.h"
+#include "build.h"
+#include "jit.h"
+#include "server.h"
 #include <iostream>
-#include <llvm/IR/LegacyPassManager.h>
-#include <llvm/Analysis/Passes.h>
+#include <chrono>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Analysis/AliasAnalysis.h>
 #include <llvm/Support/TargetSelect.h>
-#include <llvm/Transforms/Scalar.h>
-#include <llvm/Transforms/IPO.h>
 #include <llvm/Support/CommandLine.h>
-#include <llvm/Transforms/Scalar/GVN.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Transforms/IPO/Internalize.h>
+#include <llvm/Transforms/Scalar/InductiveRangeCheckElimination.h>
+#include <llvm/IR/DebugInfo.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/SourceMgr.h>
+#include <set>
 
-llvm::legacy::PassManager* mpm;
 llvm::Module* theModule;
 std::string libpath;
+static std::chrono::steady_clock::time_point startTime;
 
 int      verbosity;
 bool     timetrace;
@@ -28,13 +42,19 @@ OptLevel optimization;
 bool     rangeCheck;
 bool     debugInfo;
 bool     callGraph;
+bool     unitCache;
+int      jobs = 1;
+bool     profileGenerate;
+bool     thinLTO;
+std::string profileUse;
 Model    model = m64;
 bool     caseInsensitive = true;
 EmitType emitType;
 Standard standard = none;
 
 // Command line option definitions.
-static llvm::cl::opt<std::string>    InputFilename(llvm::cl::Positional, llvm::cl::Required, 
+// Not required, as the compile server has no input file.
+static llvm::cl::opt<std::string>    InputFilename(llvm::cl::Positional, llvm::cl::Optional,
 						llvm::cl::desc("<input file>"));
 
 static llvm::cl::opt<int, true>      Verbose("v", llvm::cl::desc("Enable verbose output"), 
@@ -44,13 +64,18 @@ static llvm::cl::opt<OptLevel, true> OptimizationLevel(llvm::cl::desc("Choose op
 						    llvm::cl::values(
 							clEnumVal(O0, "No optimizations"),
 							clEnumVal(O1, "Enable trivial optimizations"),
-							clEnumVal(O2, "Enable more optimizations")),
+							clEnumVal(O2, "Enable more optimizations"),
+							clEnumVal(O3, "Enable aggressive optimizations"),
+							clEnumVal(Os, "Optimize for size")),
 						    llvm::cl::location(optimization));
 
 static llvm::cl::opt<EmitType,true>       EmitSelection("emit", llvm::cl::desc("Choose output:"),
 						   llvm::cl::values(
 						       clEnumValN(Exe, "exe", "Executable file"),
-						       clEnumValN(LlvmIr, "llvm", "LLVM IR file")),
+						       clEnumValN(LlvmIr, "llvm", "LLVM IR file"),
+						       clEnumValN(Bitcode, "bc", "LLVM bitcode file"),
+						       clEnumValN(Asm, "asm", "Assembler file"),
+						       clEnumValN(Obj, "obj", "Object file")),
 						   llvm::cl::location(emitType));
 
 static llvm::cl::opt<bool, true>     TimetraceEnable("tt", llvm::cl::desc("Enable timetrace"),
@@ -87,59 +112,381 @@ static llvm::cl::opt<Standard, true>     StandardOpt("std",
 							 clEnumVal(iso10206, "ISO-10206 mode")),
 						     llvm::cl::location(standard));
 
+static llvm::cl::opt<bool, true>     UnitCacheOpt("unit-cache",
+						  llvm::cl::desc("Compile used units separately and "
+								 "reuse them while unchanged"),
+						  llvm::cl::location(unitCache));
 
-void OptimizerInit()
+static llvm::cl::opt<bool>     Make("make",
+				    llvm::cl::desc("Compile the units used by the program "
+						   "separately, as needed"));
+
+static llvm::cl::opt<int, true> Jobs("j", llvm::cl::desc("Number of units to compile with -make, "
+							 "and of object files to emit, at once"),
+				    llvm::cl::Prefix, llvm::cl::location(jobs));
+
+static llvm::cl::opt<bool, true> ProfileGenerate("fprofile-generate",
+						llvm::cl::desc("Instrument the program to write a "
+							       "profile (default.profraw) when run"),
+						llvm::cl::location(profileGenerate));
+
+static llvm::cl::opt<std::string, true> ProfileUse("fprofile-use",
+						   llvm::cl::desc("Optimize using the profile "
+								  "(from llvm-profdata merge)"),
+						   llvm::cl::value_desc("file"),
+						   llvm::cl::location(profileUse));
+
+static llvm::cl::opt<bool, true> ThinLTO("thin-lto",
+					llvm::cl::desc("Emit bitcode with a summary for units and "
+						       "program, and optimize across them at link"),
+					llvm::cl::location(thinLTO));
+
+static llvm::cl::opt<bool>     WholeProgram("whole-program",
+					    llvm::cl::desc("Make everything in the program internal "
+							   "when no precompiled units are used"),
+					    llvm::cl::init(true));
+
+static llvm::cl::opt<bool>     NoRuntimeInline("no-runtime-inline",
+					       llvm::cl::desc("Don't link the runtime's bitcode "
+							      "in to inline runtime functions"));
+
+static llvm::cl::opt<bool>     Run("run",
+				   llvm::cl::desc("Run the program in the compiler, with a JIT, "
+						  "instead of creating an executable"));
+
+// Only what comes after "--" can start with "-", so options after the input file
+// are still options.
+static llvm::cl::list<std::string> RunArgs(llvm::cl::Positional,
+					   llvm::cl::desc("[-- <program arguments>...]"));
+
+static llvm::cl::opt<std::string> Server("server",
+					 llvm::cl::desc("Run as compile server, listening on the socket"),
+					 llvm::cl::value_desc("socket"));
+
+static llvm::cl::opt<std::string> Connect("connect",
+					  llvm::cl::desc("Compile with the compile server on the socket"),
+					  llvm::cl::value_desc("socket"));
+
+static llvm::cl::opt<bool>     LexBench("lex-bench",
+					llvm::cl::desc("Time the lexer on the input file and exit"),
+					llvm::cl::Hidden);
+
+
+static llvm::PassBuilder::OptimizationLevel PipelineLevel()
+{
+    switch(optimization)
+    {
+    case O1:
+	return llvm::PassBuilder::O1;
+    case O2:
+	return llvm::PassBuilder::O2;
+    case O3:
+	return llvm::PassBuilder::O3;
+    case Os:
+	return llvm::PassBuilder::Os;
+    default:
+	return llvm::PassBuilder::O0;
+    }
+}
+
+static llvm::Optional<llvm::PGOOptions> ProfileOptions()
+{
+    if (profileGenerate)
+    {
+	return llvm::PGOOptions("", "", "", true);
+    }
+    if (!profileUse.empty())
+    {
+	return llvm::PGOOptions("", profileUse);
+    }
+    return llvm::None;
+}
+
+// Run LLVM's standard pipeline for the optimization level over the module. The
+// TargetMachine makes the cost models (vectorizer, unrolling, inlining) target aware.
+// With -fprofile-generate, the pipeline adds the profile counters; with
+// -fprofile-use, it sets branch weights and entry counts from the profile, for block
+// layout, inlining and switch lowering. With -Cr, range checks of loop invariant
+// indices are unswitched out of the loop by the standard pipeline, and checks of
+// induction variables are taken out by splitting the loop's iteration space.
+static bool RunPipeline(llvm::Module& module)
+{
+    TIME_TRACE();
+    if (optimization == O0)
+    {
+	return true;
+    }
+    std::unique_ptr<llvm::TargetMachine> tm(CreateTargetMachine(module.getTargetTriple()));
+    if (!tm)
+    {
+	return false;
+    }
+    llvm::PassBuilder pb(tm.get(), ProfileOptions());
+    llvm::LoopAnalysisManager lam;
+    llvm::FunctionAnalysisManager fam;
+    llvm::CGSCCAnalysisManager cgam;
+    llvm::ModuleAnalysisManager mam;
+
+    fam.registerPass([&pb] { return pb.buildDefaultAAPipeline(); });
+    pb.registerModuleAnalyses(mam);
+    pb.registerCGSCCAnalyses(cgam);
+    pb.registerFunctionAnalyses(fam);
+    pb.registerLoopAnalyses(lam);
+    pb.crossRegisterProxies(lam, fam, cgam, mam);
+
+    if (rangeCheck)
+    {
+	pb.registerLateLoopOptimizationsEPCallback(
+	    [](llvm::LoopPassManager& lpm, llvm::PassBuilder::OptimizationLevel)
+	    {
+		lpm.addPass(llvm::IRCEPass());
+	    });
+    }
+
+    // With ThinLTO, the rest of the optimization is done at link, after importing.
+    llvm::ModulePassManager mpm = (thinLTO ?
+				   pb.buildThinLTOPreLinkDefaultPipeline(PipelineLevel()) :
+				   pb.buildPerModuleDefaultPipeline(PipelineLevel()));
+    mpm.run(module, mam);
+    return true;
+}
+
+// When the program and all the units it uses are in the module, nothing but the
+// runtime refers to it from outside. Everything else is made internal, so unused
+// functions can be removed, and the rest inlined and specialized more freely.
+static void Internalize(llvm::Module& module)
 {
-    mpm = new llvm::legacy::PassManager();
+    TIME_TRACE();
+    llvm::internalizeModule(module, [](const llvm::GlobalValue& gv)
+    {
+	llvm::StringRef name = gv.getName();
+	return (name == "__PascalMain" || name == "UnitIniList" ||
+		name == "input" || name == "output");
+    });
+}
 
-    if (OptimizationLevel > O0)
+// True if the value is, or is a constant that refers to, state private to the
+// runtime: a static variable, or a function that uses one.
+static bool RefersToState(const llvm::Value* v, const std::set<const llvm::Function*>& stateful)
+{
+    if (auto gv = llvm::dyn_cast<llvm::GlobalVariable>(v))
+    {
+	return gv->hasLocalLinkage() && !gv->isConstant();
+    }
+    if (auto f = llvm::dyn_cast<llvm::Function>(v))
     {
-	// Promote allocas to registers.
-	mpm->add(llvm::createPromoteMemoryToRegisterPass());
-	// Provide basic AliasAnalysis support for GVN.
-//	mpm->add(llvm::createBasicAliasAnalysisPass());
-	// Do simple "peephole" optimizations and bit-twiddling optzns.
-	mpm->add(llvm::createInstructionCombiningPass());
-	// Reassociate expressions.
-	mpm->add(llvm::createReassociatePass());
-	// Eliminate Common SubExpressions.
-	mpm->add(llvm::createGVNPass());
-	// Simplify the control flow graph (deleting unreachable blocks, etc).
-	mpm->add(llvm::createCFGSimplificationPass());
-        // Memory copying opts. 
-	mpm->add(llvm::createMemCpyOptPass());
-	// Merge constants.
-	mpm->add(llvm::createConstantMergePass());
-	// dead code removal:
-	mpm->add(llvm::createDeadCodeEliminationPass());
-	if (OptimizationLevel > O1)
+	return stateful.count(f) != 0;
+    }
+    if (llvm::isa<llvm::GlobalValue>(v))
+    {
+	return false;
+    }
+    if (auto c = llvm::dyn_cast<llvm::Constant>(v))
+    {
+	for(auto& op : c->operands())
 	{
-	    // Inline functions. 
-	    mpm->add(llvm::createFunctionInliningPass());
-	    // Thread jumps.
-	    mpm->add(llvm::createJumpThreadingPass());
-	    // Loop strength reduce.
-	    mpm->add(llvm::createLoopStrengthReducePass());
+	    if (RefersToState(op, stateful))
+	    {
+		return true;
+	    }
 	}
     }
+    return false;
 }
 
-static int Compile(const std::string& fileName)
+static bool UsesState(const llvm::Function& f, const std::set<const llvm::Function*>& stateful)
+{
+    for(auto& bb : f)
+    {
+	for(auto& inst : bb)
+	{
+	    for(auto& op : inst.operands())
+	    {
+		if (RefersToState(op, stateful))
+		{
+		    return true;
+		}
+	    }
+	}
+    }
+    return false;
+}
+
+// Link the runtime's bitcode into the module, so the optimizer can inline runtime
+// functions into the Pascal code and optimize them together. The runtime library
+// is still linked with the program, so there is only one copy of the runtime: the
+// functions are made available_externally and the variables declarations. Functions
+// using the runtime's static variables (and main) are left as declarations.
+static void LinkRuntime(llvm::Module& module)
 {
     TIME_TRACE();
-    theModule = CreateModule();
-    Builtin::InitBuiltins();
-    FileSource source(fileName);
+    // Only a 64-bit runtime is built as bitcode.
+    if (model == m32)
+    {
+	return;
+    }
+    std::string name = libpath + "/libruntime.bc";
+    llvm::SMDiagnostic err;
+    std::unique_ptr<llvm::Module> runtime = llvm::parseIRFile(name, err, module.getContext());
+    if (!runtime)
+    {
+	if (verbosity)
+	{
+	    std::cerr << "Could not read " << name << ", runtime not inlined" << std::endl;
+	}
+	return;
+    }
+    llvm::StripDebugInfo(*runtime);
+    if (llvm::NamedMDNode* flags = runtime->getModuleFlagsMetadata())
+    {
+	flags->eraseFromParent();
+    }
+    runtime->setTargetTriple(module.getTargetTriple());
+    runtime->setDataLayout(module.getDataLayout());
+
+    std::set<const llvm::Function*> stateful;
+    for(bool changed = true; changed;)
+    {
+	changed = false;
+	for(auto& f : *runtime)
+	{
+	    if (!f.isDeclaration() && !stateful.count(&f) &&
+		(f.getName() == "main" || UsesState(f, stateful)))
+	    {
+		stateful.insert(&f);
+		changed = true;
+	    }
+	}
+    }
+
+    // X86 only inlines between functions with compatible target attributes, so the
+    // runtime gets the same ones as the generated code, instead of clang's.
+    for(auto& f : *runtime)
+    {
+	f.removeFnAttr("target-cpu");
+	f.removeFnAttr("target-features");
+	if (!TargetCPU().empty())
+	{
+	    f.addFnAttr("target-cpu", TargetCPU());
+	}
+	if (!TargetFeatures().empty())
+	{
+	    f.addFnAttr("target-features", TargetFeatures());
+	}
+    }
+
+    // Only what the module uses is linked in, so the runtime's static variables and
+    // internal functions using them are left behind.
+    for(auto& f : *runtime)
+    {
+	if (f.isDeclaration() || f.hasLocalLinkage())
+	{
+	    continue;
+	}
+	if (stateful.count(&f))
+	{
+	    f.deleteBody();
+	}
+	else
+	{
+	    f.setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+	}
+    }
+    for(auto& gv : runtime->globals())
+    {
+	if (!gv.hasLocalLinkage())
+	{
+	    gv.setInitializer(0);
+	    gv.setLinkage(llvm::GlobalValue::ExternalLinkage);
+	}
+    }
+
+    if (llvm::Linker::linkModules(module, std::move(runtime), llvm::Linker::Flags::LinkOnlyNeeded))
+    {
+	std::cerr << "Linking " << name << " failed, runtime not inlined" << std::endl;
+    }
+}
+
+static bool Optimize()
+{
+    if (optimization != O0 && !NoRuntimeInline)
+    {
+	LinkRuntime(*theModule);
+    }
+    return RunPipeline(*theModule);
+}
+
+// Run the lexer over the whole file, returning number of tokens or -1 on error.
+static int LexFile(Source& source)
+{
+    Lexer lex(source);
+    int count = 0;
+    for(;;)
+    {
+	Token t = lex.GetToken();
+	if (t.GetToken() == Token::EndOfFile)
+	{
+	    return count;
+	}
+	if (t.GetToken() == Token::Unknown)
+	{
+	    return -1;
+	}
+	count++;
+    }
+}
+
+static int LexBenchmark(const std::string& fileName)
+{
+    MappedFileSource mapped(fileName);
+    if (!mapped)
+    {
+	std::cerr << "Could not open " << fileName << std::endl;
+	return 1;
+    }
+    double mb = mapped.Size() / (1024.0 * 1024.0);
+
+    auto start = std::chrono::steady_clock::now();
+    int tokens = LexFile(mapped);
+    std::chrono::duration<double> bufTime = std::chrono::steady_clock::now() - start;
+
+    FileSource file(fileName);
+    start = std::chrono::steady_clock::now();
+    int charTokens = LexFile(file);
+    std::chrono::duration<double> charTime = std::chrono::steady_clock::now() - start;
+
+    if (tokens < 0 || tokens != charTokens)
+    {
+	std::cerr << "Lexer error or token count mismatch: " << tokens << " vs "
+		  << charTokens << std::endl;
+	return 1;
+    }
+    std::cout << fileName << ": " << tokens << " tokens, " << mb << " MB" << std::endl;
+    std::cout << "  buffer: " << bufTime.count() << "s, " << mb / bufTime.count() << " MB/s"
+	      << std::endl;
+    std::cout << "  char:   " << charTime.count() << "s, " << mb / charTime.count() << " MB/s"
+	      << std::endl;
+    return 0;
+}
+
+// Parse, analyse and generate code for the file into theModule. The AST, types
+// and constants are allocated in an arena that is released once the code is
+// generated, so they are not kept around while optimising and linking.
+static int Generate(const std::string& fileName, Parser::ParserType type)
+{
+    Arena arena;
+    ArenaScope scope(arena);
+    Types::TypeContext typeContext;
+    MappedFileSource source(fileName);
     if (!source)
     {
 	std::cerr << "Could not open " << fileName << std::endl;
 	return 1;
     }
     Parser p(source);
+    ResetCodeGen();
 
-    OptimizerInit();
-
-    ExprAST* ast = p.Parse(Parser::Program);
+    ExprAST* ast = p.Parse(type);
     if (int e = p.GetErrors())
     {
 	std::cerr << "Errors in parsing: " << e << ".\nExiting..." << std::endl;
@@ -171,25 +518,225 @@ static int Compile(const std::string& fileName)
 	    ast->dump(std::cerr);
 	    return 1;
 	}
-	BackPatch();
+	BackPatch(type == Parser::Program);
+    }
+
+    if (llvm::AreStatisticsEnabled())
+    {
+	arena.PrintStats(std::cerr);
+    }
+    return 0;
+}
+
+// Compile a unit on its own into an object, and write its .pui file.
+static int CompileUnit(const std::string& fileName)
+{
+    TIME_TRACE();
+    UnitCache::Reset();
+    theModule = CreateModule();
+
+    if (int e = Generate(fileName, Parser::UnitObject))
+    {
+	return e;
+    }
+
+    if (!Optimize())
+    {
+	return 1;
+    }
+    std::string objName = replace_ext(fileName, ".pas", ".o");
+    if (!CreateObject(theModule, objName))
+    {
+	return 1;
+    }
+    // Units used that were not up to date got compiled into this object as well, so
+    // it can't be reused until they have been compiled on their own.
+    if (!UnitCache::TakeStale().empty())
+    {
+	return 0;
+    }
+    if (!UnitCache::Write(fileName, UnitCache::HashFile(fileName), objName))
+    {
+	return 1;
+    }
+    return 0;
+}
+
+// Units that were out of date were compiled as part of the program. Compile them
+// on their own now (dependencies first), so the next compile can reuse them.
+static int CompileStaleUnits()
+{
+    llvm::Module* program = theModule;
+    for(auto& unit : UnitCache::TakeStale())
+    {
+	if (int e = CompileUnit(unit))
+	{
+	    return e;
+	}
+    }
+    theModule = program;
+    return 0;
+}
+
+static int Compile(const std::string& fileName)
+{
+    TIME_TRACE();
+    theModule = CreateModule();
+
+    if (int e = Generate(fileName, Parser::Program))
+    {
+	return e;
     }
 
     if (verbosity)
     {
 	theModule->dump();
     }
-    mpm->run(*theModule);
+    if (WholeProgram && UnitCache::Objects().empty())
+    {
+	Internalize(*theModule);
+    }
+    if (!Optimize())
+    {
+	return 1;
+    }
+
+    if (Run)
+    {
+	// Taken first, as compiling the stale units resets the used units.
+	std::vector<std::string> objects = UnitCache::Objects();
+	if (int e = CompileStaleUnits())
+	{
+	    return e;
+	}
+	// ParamStr(0) is what the executable would have been called.
+	std::vector<std::string> args(1, replace_ext(fileName, ".pas", ""));
+	args.insert(args.end(), RunArgs.begin(), RunArgs.end());
+	int res = RunProgram(theModule, objects, args, startTime);
+	theModule = 0;
+	return (res < 0) ? 1 : res;
+    }
     if (!CreateBinary(theModule, fileName, EmitSelection))
     {
 	return 1;
     }
-    return 0;
+    if (timetrace)
+    {
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+	std::cerr << "Compile and link: " << elapsed.count() << " ms" << std::endl;
+    }
+    return CompileStaleUnits();
+}
+
+// Everything after the command line is parsed, in the compiler or in the server.
+static int Main()
+{
+    if (InputFilename.empty())
+    {
+	std::cerr << "No input file given" << std::endl;
+	return 1;
+    }
+    if (!RunArgs.empty() && !Run)
+    {
+	std::cerr << "Program arguments can only be given with -run" << std::endl;
+	return 1;
+    }
+    ResolveTarget();
+    if (LexBench)
+    {
+	return LexBenchmark(InputFilename);
+    }
+    if ((profileGenerate || !profileUse.empty()) && optimization == O0)
+    {
+	std::cerr << "Profiling needs optimization, -O1 or higher" << std::endl;
+	return 1;
+    }
+    if (profileGenerate && (Run || model == m32))
+    {
+	std::cerr << "-fprofile-generate can't be used with -run or -m32" << std::endl;
+	return 1;
+    }
+    if (thinLTO && Run)
+    {
+	std::cerr << "-thin-lto can't be used with -run" << std::endl;
+	return 1;
+    }
+    if (Make)
+    {
+	unitCache = true;
+	if (int e = MakeUnits(InputFilename, jobs, CompileUnit))
+	{
+	    return e;
+	}
+    }
+    return Compile(InputFilename);
+}
+
+// A request to the server, in a process of its own, so options start from defaults.
+static int ServerCompile(const std::vector<std::string>& args)
+{
+    startTime = std::chrono::steady_clock::now();
+    std::vector<const char*> argv(1, "lacsap");
+    for(auto& a : args)
+    {
+	argv.push_back(a.c_str());
+    }
+    llvm::cl::ResetAllOptionOccurrences();
+    llvm::cl::ParseCommandLineOptions(argv.size(), argv.data());
+    if (!Server.empty() || !Connect.empty())
+    {
+	std::cerr << "Can't use -server or -connect in a request to the server" << std::endl;
+	return 1;
+    }
+    return Main();
+}
+
+// The arguments for the server: all but -connect.
+static std::vector<std::string> ClientArgs(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for(int i = 1; i < argc; i++)
+    {
+	llvm::StringRef arg(argv[i]);
+	if (arg == "--")
+	{
+	    args.insert(args.end(), argv + i, argv + argc);
+	    break;
+	}
+	if (arg == "-connect" || arg == "--connect")
+	{
+	    i++;
+	}
+	else if (!arg.startswith("-connect=") && !arg.startswith("--connect="))
+	{
+	    args.push_back(arg.str());
+	}
+    }
+    return args;
 }
 
 int main(int argc, char** argv)
 {
+    startTime = std::chrono::steady_clock::now();
     libpath = GetPath(argv[0]);
     llvm::cl::ParseCommandLineOptions(argc, argv);
-    int res = Compile(InputFilename);
-    return res;
+    if (!Connect.empty())
+    {
+	return RunClient(Connect, ClientArgs(argc, argv));
+    }
+    Builtin::InitBuiltins();
+    if (!Server.empty())
+    {
+	// Requests run in other directories.
+	llvm::SmallString<256> path(libpath);
+	llvm::sys::fs::make_absolute(path);
+	libpath = path.str().str();
+	// Set up the targets, so each request doesn't. The CPU and features come
+	// from the options of each request.
+	InitializeTargets();
+	std::string serverName = Server;
+	Server.setValue("");
+	return RunServer(serverName, ServerCompile);
+    }
+    return Main();
 }
@@ -7,8 +7,20 @@
 #include <iostream>
 #include <cstdlib>
 
-Lexer::Lexer(Source& source) : source(source), curValid(0)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+Lexer::Lexer(Source& source)
+    : source(source), curValid(0), bufStart(source.Data()), bufEnd(0), cur(0), lookAhead(1)
 {
+    if (bufStart)
+    {
+	bufEnd = bufStart + source.Size();
+	cur = bufStart;
+    }
 }
 
 int Lexer::GetChar()
@@ -222,6 +234,11 @@ static const SingleCharToken singleCharTokenTable[] =
 
 Token Lexer::GetToken()
 {
+    if (bufStart)
+    {
+	return BufferToken();
+    }
+
     int ch = CurChar();
     Location w = Where();
 
@@ -373,3 +390,370 @@ Token Lexer::GetToken()
     std::cerr << "ch=" << ch << std::endl;
     return Token(Token::Unknown, w);
 }
+
+// Character class scanning for the buffer mode. Where SSE2 or AVX2 is available,
+// we check 16 or 32 bytes at a time, then finish off the tail one byte at a time.
+#if defined(__AVX2__)
+typedef __m256i VecType;
+const int VecWidth = 32;
+static inline VecType VecLoad(const char* p) { return _mm256_loadu_si256((const __m256i*)p); }
+static inline VecType VecSplat(char c) { return _mm256_set1_epi8(c); }
+static inline VecType VecEq(VecType a, VecType b) { return _mm256_cmpeq_epi8(a, b); }
+static inline VecType VecOr(VecType a, VecType b) { return _mm256_or_si256(a, b); }
+static inline VecType VecSub(VecType a, VecType b) { return _mm256_sub_epi8(a, b); }
+static inline VecType VecMin(VecType a, VecType b) { return _mm256_min_epu8(a, b); }
+static inline uint32_t VecMask(VecType v) { return _mm256_movemask_epi8(v); }
+#elif defined(__SSE2__)
+typedef __m128i VecType;
+const int VecWidth = 16;
+static inline VecType VecLoad(const char* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline VecType VecSplat(char c) { return _mm_set1_epi8(c); }
+static inline VecType VecEq(VecType a, VecType b) { return _mm_cmpeq_epi8(a, b); }
+static inline VecType VecOr(VecType a, VecType b) { return _mm_or_si128(a, b); }
+static inline VecType VecSub(VecType a, VecType b) { return _mm_sub_epi8(a, b); }
+static inline VecType VecMin(VecType a, VecType b) { return _mm_min_epu8(a, b); }
+static inline uint32_t VecMask(VecType v) { return _mm_movemask_epi8(v); }
+#else
+const int VecWidth = 0;
+#endif
+const uint32_t VecAllBits = (VecWidth == 32) ? ~0U : (1U << VecWidth) - 1;
+
+#if defined(__AVX2__) || defined(__SSE2__)
+// Bytes in the range [low, low+n] (unsigned).
+static inline VecType VecInRange(VecType x, char low, char n)
+{
+    VecType t = VecSub(x, VecSplat(low));
+    return VecEq(VecMin(t, VecSplat(n)), t);
+}
+
+static inline VecType VecIsSpace(VecType x)
+{
+    return VecOr(VecEq(x, VecSplat(' ')), VecInRange(x, '\t', '\r' - '\t'));
+}
+
+static inline VecType VecIsIdent(VecType x)
+{
+    VecType lower = VecOr(x, VecSplat(0x20));
+    return VecOr(VecOr(VecInRange(lower, 'a', 'z' - 'a'), VecInRange(x, '0', 9)),
+		 VecEq(x, VecSplat('_')));
+}
+#endif
+
+static inline bool IsSpace(char ch)
+{
+    return ch == ' ' || (ch >= '\t' && ch <= '\r');
+}
+
+static inline bool IsIdent(char ch)
+{
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') ||
+	ch == '_';
+}
+
+static const char* SkipSpace(const char* p, const char* end)
+{
+#if defined(__AVX2__) || defined(__SSE2__)
+    while (end - p >= VecWidth)
+    {
+	if (uint32_t m = ~VecMask(VecIsSpace(VecLoad(p))) & VecAllBits)
+	{
+	    return p + __builtin_ctz(m);
+	}
+	p += VecWidth;
+    }
+#endif
+    while (p < end && IsSpace(*p))
+    {
+	p++;
+    }
+    return p;
+}
+
+static const char* SkipIdent(const char* p, const char* end)
+{
+#if defined(__AVX2__) || defined(__SSE2__)
+    while (end - p >= VecWidth)
+    {
+	if (uint32_t m = ~VecMask(VecIsIdent(VecLoad(p))) & VecAllBits)
+	{
+	    return p + __builtin_ctz(m);
+	}
+	p += VecWidth;
+    }
+#endif
+    while (p < end && IsIdent(*p))
+    {
+	p++;
+    }
+    return p;
+}
+
+// Returns pointer to first ch, or end if not found.
+static const char* FindChar(const char* p, const char* end, char ch)
+{
+#if defined(__AVX2__) || defined(__SSE2__)
+    VecType c = VecSplat(ch);
+    while (end - p >= VecWidth)
+    {
+	if (uint32_t m = VecMask(VecEq(VecLoad(p), c)))
+	{
+	    return p + __builtin_ctz(m);
+	}
+	p += VecWidth;
+    }
+#endif
+    while (p < end && *p != ch)
+    {
+	p++;
+    }
+    return p;
+}
+
+Token Lexer::BufferNumberToken()
+{
+    Location w = BufferWhere();
+    lookAhead = 1;
+    int base = 10;
+    if (*cur == '$')
+    {
+	base = 16;
+	cur++;
+    }
+    const char* p = cur;
+    bool isFloat = false;
+    if (base == 16)
+    {
+	while(p < bufEnd && isxdigit(static_cast<unsigned char>(*p)))
+	{
+	    p++;
+	}
+    }
+    else
+    {
+	while(p < bufEnd && isdigit(static_cast<unsigned char>(*p)))
+	{
+	    p++;
+	}
+	// A '.' followed by '.' or ')' is a range or a closing bracket, not a fraction.
+	if (p < bufEnd && *p == '.' && p + 1 < bufEnd && (p[1] == '.' || p[1] == ')'))
+	{
+	    lookAhead = 2;
+	}
+	else if (p < bufEnd && *p == '.')
+	{
+	    isFloat = true;
+	    p++;
+	    while(p < bufEnd && isdigit(static_cast<unsigned char>(*p)))
+	    {
+		p++;
+	    }
+	}
+	if (p < bufEnd && (*p == 'e' || *p == 'E'))
+	{
+	    isFloat = true;
+	    p++;
+	    if (p < bufEnd && (*p == '+' || *p == '-'))
+	    {
+		p++;
+	    }
+	    while(p < bufEnd && isdigit(static_cast<unsigned char>(*p)))
+	    {
+		p++;
+	    }
+	}
+    }
+    std::string num(cur, p);
+    cur = p;
+    if (isFloat)
+    {
+	return ConvertFloat(num, w);
+    }
+    return ConvertInt(num, w, base);
+}
+
+Token Lexer::BufferStringToken()
+{
+    Location w = BufferWhere();
+    char quote = *cur;
+    const char* p = cur + 1;
+    std::string str;
+    for(;;)
+    {
+	const char* s = p;
+	while(p < bufEnd && *p != quote && *p != '\n')
+	{
+	    p++;
+	}
+	str.append(s, p);
+	if (p == bufEnd || *p == '\n')
+	{
+	    cur = p;
+	    return Token(Token::UntermString, w);
+	}
+	// Two quotes in a row is a quote character in the string.
+	if (p + 1 < bufEnd && p[1] == quote)
+	{
+	    str += quote;
+	    p += 2;
+	    continue;
+	}
+	break;
+    }
+    cur = p + 1;
+    if (str.size() == 1)
+    {
+	return Token(Token::Char, w, (uint64_t)str[0]);
+    }
+    return Token(Token::StringLiteral, w, str);
+}
+
+Token Lexer::BufferToken()
+{
+    Location w = BufferWhere();
+    lookAhead = 1;
+
+    for(;;)
+    {
+	cur = SkipSpace(cur, bufEnd);
+	if (cur < bufEnd && *cur == '{')
+	{
+	    const char* p = FindChar(cur + 1, bufEnd, '}');
+	    cur = (p < bufEnd) ? p + 1 : bufEnd;
+	}
+	else if (bufEnd - cur >= 2 && cur[0] == '(' && cur[1] == '*')
+	{
+	    const char* p = cur + 2;
+	    while((p = FindChar(p, bufEnd, '*')) < bufEnd && !(p + 1 < bufEnd && p[1] == ')'))
+	    {
+		p++;
+	    }
+	    cur = (p < bufEnd) ? p + 2 : bufEnd;
+	}
+	else
+	{
+	    break;
+	}
+    }
+
+    // EOF -> return now...
+    if (cur == bufEnd)
+    {
+	return Token(Token::EndOfFile, w);
+    }
+
+    char ch = *cur;
+    int peek = (cur + 1 < bufEnd) ? static_cast<unsigned char>(cur[1]) : EOF;
+    Token::TokenType tt = Token::Unknown;
+    int len = 1;
+    switch(ch)
+    {
+    case '.':
+	tt = Token::Period;
+	if (peek == '.')
+	{
+	    tt = Token::DotDot;
+	    len = 2;
+	}
+	else if (peek == ')')
+	{
+	    tt = Token::RightSquare;
+	    len = 2;
+	}
+	break;
+
+    case '<':
+	tt = Token::LessThan;
+	if (peek == '=')
+	{
+	    tt = Token::LessOrEqual;
+	    len = 2;
+	}
+	else if (peek == '>')
+	{
+	    tt = Token::NotEqual;
+	    len = 2;
+	}
+	break;
+
+    case '>':
+	tt = Token::GreaterThan;
+	if (peek == '=')
+	{
+	    tt = Token::GreaterOrEqual;
+	    len = 2;
+	}
+	break;
+
+    case ':':
+	tt = Token::Colon;
+	if (peek == '=')
+	{
+	    tt = Token::Assign;
+	    len = 2;
+	}
+	break;
+
+    case '(':
+	if (peek == '.')
+	{
+	    tt = Token::LeftSquare;
+	    len = 2;
+	}
+	break;
+    }
+    if (tt != Token::Unknown)
+    {
+	cur += len;
+	return Token(tt, w);
+    }
+    for(auto i : singleCharTokenTable)
+    {
+	if (i.ch == ch)
+	{
+	    cur++;
+	    return Token(i.t, w);
+	}
+    }
+
+    if (ch == '\'' || ch == '"')
+    {
+	return BufferStringToken();
+    }
+
+    // Identifiers start with alpha characters, or underscore.
+    if (std::isalpha(static_cast<unsigned char>(ch)) || ch == '_')
+    {
+	const char* start = cur;
+	cur = SkipIdent(cur + 1, bufEnd);
+	size_t len = cur - start;
+	Token::TokenType tt = Token::KeyWordToToken(start, len);
+	if (tt == Token::LineNumber)
+	{
+	    return Token(Token::Integer, w, (uint64_t)w.LineNumber());
+	}
+	else if (tt == Token::FileName)
+	{
+	    return Token(Token::StringLiteral, w, w.FileName());
+	}
+	else if (tt != Token::Unknown)
+	{
+	    return Token(tt, w);
+	}
+	return Token(Token::Identifier, w, start, len);
+    }
+
+    // Digit, so a number. Either "real" or "integer".
+    if (std::isdigit(static_cast<unsigned char>(ch)))
+    {
+	return BufferNumberToken();
+    }
+    if (ch == '$' && std::isxdigit(peek))
+    {
+	// The character lexer has peeked past the '$' at this point.
+	lookAhead = 2;
+	return BufferNumberToken();
+    }
+    // We really shouldn't get here!
+    std::cerr << "ch=" << (int)ch << std::endl;
+    return Token(Token::Unknown, w);
+}
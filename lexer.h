@@ -27,11 +27,22 @@ private:
 
     Location Where() const { return Location(source); }
 
+    // Buffer mode: used when the source has the whole input in memory.
+    Token BufferToken();
+    Token BufferNumberToken();
+    Token BufferStringToken();
+    Location BufferWhere() const { return source.LocationAt(cur - bufStart + lookAhead); }
+
 private:
     Source &source;
     int     curChar;
     int     nextChar;
     int     curValid;
+    const char* bufStart;
+    const char* bufEnd;
+    const char* cur;
+    // Matches the character lexer, which reports locations after its lookahead.
+    int         lookAhead;
 };
 
 #endif
@@ -0,0 +1,144 @@
+#include "link.h"
+#include "options.h"
+#include "trace.h"
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/Triple.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include <iostream>
+
+#if LLD_DISABLE==0
+#include <lld/Common/Driver.h>
+
+static std::string FindFile(const std::vector<std::string>& dirs, const std::string& name)
+{
+    for(auto& d : dirs)
+    {
+	std::string path = d + "/" + name;
+	if (llvm::sys::fs::exists(path))
+	{
+	    return path;
+	}
+    }
+    return "";
+}
+
+// Find the newest gcc directory for the architecture, for crtbegin.o, crtend.o and
+// libgcc.
+static std::string FindGccDir(const std::string& arch)
+{
+    std::string best;
+    std::string bestVersion;
+    for(auto root : { "/usr/lib/gcc", "/usr/lib64/gcc" })
+    {
+	std::error_code ec;
+	for(llvm::sys::fs::directory_iterator t(root, ec), end; !ec && t != end; t.increment(ec))
+	{
+	    if (!llvm::StringRef(llvm::sys::path::filename(t->path())).startswith(arch))
+	    {
+		continue;
+	    }
+	    std::error_code vec;
+	    for(llvm::sys::fs::directory_iterator v(t->path(), vec); !vec && v != end;
+		v.increment(vec))
+	    {
+		std::string version = llvm::sys::path::filename(v->path()).str();
+		if (llvm::sys::fs::exists(v->path() + "/crtbegin.o") &&
+		    llvm::StringRef(version).compare_numeric(bestVersion) > 0)
+		{
+		    best = v->path();
+		    bestVersion = version;
+		}
+	    }
+	}
+    }
+    return best;
+}
+
+// Optimization level for the code generated at link time with ThinLTO.
+static int LTOLevel()
+{
+    switch(optimization)
+    {
+    case O0:
+	return 0;
+    case O1:
+	return 1;
+    case O3:
+	return 3;
+    default:
+	return 2;
+    }
+}
+
+bool LinkInProcess(const std::vector<std::string>& objects, const std::string& exename)
+{
+    TIME_TRACE();
+    llvm::Triple triple(llvm::sys::getDefaultTargetTriple());
+    if (model != m64 || triple.getArch() != llvm::Triple::x86_64 || !triple.isOSLinux())
+    {
+	return false;
+    }
+
+    std::string arch = triple.getArchName();
+    std::vector<std::string> libDirs = { "/usr/lib/" + arch + "-linux-gnu",
+					 "/lib/" + arch + "-linux-gnu",
+					 "/usr/lib64", "/lib64", "/usr/lib", "/lib" };
+    std::string gccDir = FindGccDir(arch);
+    std::string crt1 = FindFile(libDirs, "crt1.o");
+    std::string crti = FindFile(libDirs, "crti.o");
+    std::string crtn = FindFile(libDirs, "crtn.o");
+    if (gccDir.empty() || crt1.empty() || crti.empty() || crtn.empty())
+    {
+	if (verbosity)
+	{
+	    std::cerr << "Could not find C start files, not linking with lld" << std::endl;
+	}
+	return false;
+    }
+
+    std::vector<std::string> args = { "ld.lld", "--eh-frame-hdr", "-m", "elf_x86_64",
+				      "-dynamic-linker", "/lib64/ld-linux-x86-64.so.2",
+				      "-o", exename, crt1, crti, gccDir + "/crtbegin.o",
+				      "-L" + gccDir };
+    for(auto& d : libDirs)
+    {
+	args.push_back("-L" + d);
+    }
+    if (thinLTO)
+    {
+	// Modules that are unchanged, with the same imports, are not compiled again.
+	std::string dir = llvm::sys::path::parent_path(exename).str();
+	args.push_back("--thinlto-cache-dir=" + (dir.empty() ? "." : dir) + "/thinlto-cache");
+	args.push_back("--thinlto-jobs=" + std::to_string(jobs));
+	args.push_back("--lto-O" + std::to_string(LTOLevel()));
+    }
+    args.insert(args.end(), objects.begin(), objects.end());
+    args.insert(args.end(), { libpath + "/libruntime.a", "-lm", "-lc", "-lgcc",
+			      "--as-needed", "-lgcc_s", "--no-as-needed",
+			      gccDir + "/crtend.o", crtn });
+
+    std::vector<const char*> argv;
+    for(auto& a : args)
+    {
+	argv.push_back(a.c_str());
+    }
+    if (verbosity)
+    {
+	std::cerr << "Linking with:";
+	for(auto a : argv)
+	{
+	    std::cerr << " " << a;
+	}
+	std::cerr << std::endl;
+    }
+    return lld::elf::link(argv, false, llvm::errs());
+}
+#else
+bool LinkInProcess(const std::vector<std::string>&, const std::string&)
+{
+    return false;
+}
+#endif
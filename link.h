@@ -0,0 +1,13 @@
+#ifndef LINK_H
+#define LINK_H
+
+#include <string>
+#include <vector>
+
+// Link the objects with the runtime into an executable, using lld in the compiler
+// process rather than running the C compiler as linker. Only done for 64-bit x86
+// Linux, where the C library start files can be found. Returns false if it could not
+// link, so the caller can use the C compiler instead.
+bool LinkInProcess(const std::vector<std::string>& objects, const std::string& exename);
+
+#endif
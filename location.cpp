@@ -1,9 +1,50 @@
 #include "location.h"
-//#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <unordered_map>
+
+class FileTable
+{
+public:
+    FileTable() { Get(""); }
+    FileId Get(const std::string& name)
+    {
+	auto res = ids.insert(std::make_pair(name, static_cast<FileId>(names.size())));
+	if (res.second)
+	{
+	    names.push_back(name);
+	}
+	return res.first->second;
+    }
+    const std::string& Name(FileId id) const
+    {
+	assert(id < names.size() && "Invalid file id");
+	return names[id];
+    }
+private:
+    std::unordered_map<std::string, FileId> ids;
+    std::deque<std::string>                 names;
+};
+
+static FileTable& Files()
+{
+    static FileTable files;
+    return files;
+}
+
+FileId GetFileId(const std::string& name)
+{
+    return Files().Get(name);
+}
+
+const std::string& GetFileName(FileId id)
+{
+    return Files().Name(id);
+}
 
 std::string Location::to_string() const
 {
-    return fname+ ":" + std::to_string(lineNum) + ":" + std::to_string(column) + ":";
+    return FileName() + ":" + std::to_string(lineNum) + ":" + std::to_string(column) + ":";
 }
 
 std::ostream& operator<<(std::ostream &os, const Location& loc)
@@ -3,22 +3,33 @@
 
 #include <string>
 #include <ostream>
+#include <cstdint>
+
+// File names are kept in a table, and locations refer to them by index, so a
+// Location is small and cheap to copy. FileId 0 is the empty name.
+typedef uint32_t FileId;
+
+FileId GetFileId(const std::string& name);
+const std::string& GetFileName(FileId id);
 
 class Location
 {
 public:
     Location(const std::string& file, int line, int col)
-	: fname(file), lineNum(line), column(col) {}
+	: file(GetFileId(file)), lineNum(line), column(col) {}
+    Location(FileId f, int line, int col)
+	: file(f), lineNum(line), column(col) {}
     Location()
-	: fname(""), lineNum(0), column(0) {}
+	: file(0), lineNum(0), column(0) {}
     std::string to_string() const;
-    std::string FileName() const { return fname; }
-    operator bool () const { return fname != "" || lineNum != 0; }
+    const std::string& FileName() const { return GetFileName(file); }
+    FileId File() const { return file; }
+    operator bool () const { return file != 0 || lineNum != 0; }
     unsigned int LineNumber() const { return lineNum; }
     unsigned int Column() const { return column; }
 
 private:
-    std::string fname;
+    FileId       file;
     unsigned int lineNum;
     unsigned int column;
 };
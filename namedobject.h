@@ -3,6 +3,7 @@
 
 #include "types.h"
 #include "constants.h"
+#include "symbol.h"
 #include <llvm/Support/Casting.h>
 #include <iostream>
 
@@ -25,15 +26,17 @@ public:
 	NK_Label,
     };
     NamedObject(NamedKind k, const std::string& nm, Types::TypeDecl* ty) 
-	: kind(k), name(nm), type(ty) {}
+	: kind(k), name(nm), symbol(Intern(nm)), type(ty) {}
     virtual ~NamedObject() {}
     Types::TypeDecl* Type() const { return type; }
     const std::string& Name() const { return name; }
+    SymbolId Symbol() const { return symbol; }
     virtual void dump(std::ostream& out) const;
     NamedKind getKind() const { return kind; }
 private:
     NamedKind kind;
     std::string name;
+    SymbolId symbol;
     Types::TypeDecl* type;
 };
 
@@ -7,6 +7,9 @@ enum EmitType
 {
     Exe, // Default
     LlvmIr,
+    Bitcode,
+    Asm,
+    Obj,
 };
 
 enum OptLevel
@@ -14,6 +17,8 @@ enum OptLevel
     O0,
     O1,
     O2,
+    O3,
+    Os,
 };
 
 enum Model
@@ -35,6 +40,11 @@ extern bool        disableMemcpyOpt;
 extern bool        rangeCheck;
 extern bool        debugInfo;
 extern bool        callGraph;
+extern bool        unitCache;
+extern int         jobs;
+extern bool        profileGenerate;
+extern bool        thinLTO;
+extern std::string profileUse;
 extern OptLevel    optimization;
 extern Model       model;
 extern bool        caseInsensitive;
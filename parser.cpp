@@ -8,6 +8,7 @@
 #include "options.h"
 #include "trace.h"
 #include "utils.h"
+#include "unitcache.h"
 #include <iostream>
 #include <cassert>
 #include <limits>
@@ -169,7 +170,7 @@ bool Parser::AcceptToken(Token::TokenType type, const char *file, int line)
 #define AssertToken(t) AssertToken(t, __FILE__, __LINE__)
 #define AcceptToken(t) AcceptToken(t, __FILE__, __LINE__)
 
-Types::TypeDecl* Parser::GetTypeDecl(const std::string& name)
+Types::TypeDecl* Parser::GetTypeDecl(SymbolId name)
 {
     if (const TypeDef *typeDef = llvm::dyn_cast_or_null<const TypeDef>(nameStack.Find(name)))
     {
@@ -188,7 +189,7 @@ ExprAST* Parser::ParseSizeOfExpr()
     ExprAST* expr = 0;
     if (CurrentToken().GetToken() == Token::Identifier)
     {
-	if (Types::TypeDecl* ty = GetTypeDecl(CurrentToken().GetIdentName()))
+	if (Types::TypeDecl* ty = GetTypeDecl(CurrentToken().GetSymbol()))
 	{
 	    expr = new SizeOfExprAST(CurrentToken().Loc(), ty);
 	    AssertToken(Token::Identifier);
@@ -254,7 +255,7 @@ ExprAST* Parser::ParseGoto()
     return 0;
 }
 
-const Constants::ConstDecl* Parser::GetConstDecl(const std::string& name)
+const Constants::ConstDecl* Parser::GetConstDecl(SymbolId name)
 {
     if (const ConstDef *constDef = llvm::dyn_cast_or_null<const ConstDef>(nameStack.Find(name)))
     {
@@ -263,7 +264,7 @@ const Constants::ConstDecl* Parser::GetConstDecl(const std::string& name)
     return 0;
 }
 
-const EnumDef* Parser::GetEnumValue(const std::string& name)
+const EnumDef* Parser::GetEnumValue(SymbolId name)
 {
     return llvm::dyn_cast_or_null<EnumDef>(nameStack.Find(name));
 }
@@ -287,7 +288,7 @@ Types::TypeDecl* Parser::ParseSimpleType()
 {
     if (Expect(Token::Identifier, false))
     {
-	if (Types::TypeDecl* ty = GetTypeDecl(CurrentToken().GetIdentName()))
+	if (Types::TypeDecl* ty = GetTypeDecl(CurrentToken().GetSymbol()))
 	{
 	    AssertToken(Token::Identifier);
 	    return ty;
@@ -302,7 +303,7 @@ Token Parser::TranslateToken(const Token& token)
 {
     if (token.GetToken() == Token::Identifier)
     {
-	if (const Constants::ConstDecl* cd = GetConstDecl(token.GetIdentName()))
+	if (const Constants::ConstDecl* cd = GetConstDecl(token.GetSymbol()))
 	{
 	    return cd->Translate();
 	}
@@ -342,7 +343,7 @@ int64_t Parser::ParseConstantValue(Token::TokenType& tt, Types::TypeDecl*& type)
     {
 	tt = CurrentToken().GetToken();
 	
-	if (const EnumDef* ed = GetEnumValue(CurrentToken().GetIdentName()))
+	if (const EnumDef* ed = GetEnumValue(CurrentToken().GetSymbol()))
 	{
 	    type = ed->Type();
 	    result = ed->Value();
@@ -399,21 +400,21 @@ Types::RangeDecl* Parser::ParseRange(Types::TypeDecl*& type)
     {
 	return ErrorR(CurrentToken(), "Invalid range specification");
     }
-    return new Types::RangeDecl(new Types::Range(start, end), type);
+    return Types::MakeRangeDecl(start, end, type);
 }
 
 Types::RangeDecl* Parser::ParseRangeOrTypeRange(Types::TypeDecl*& type)
 {
     if (CurrentToken().GetToken() == Token::Identifier)
     {
-	if ((type = GetTypeDecl(CurrentToken().GetIdentName())))
+	if ((type = GetTypeDecl(CurrentToken().GetSymbol())))
 	{
 	    if (!type->IsIntegral())
 	    {
 		return ErrorR(CurrentToken(), "Type used as index specification should be integral type");
 	    }
 	    AssertToken(Token::Identifier);
-	    return new Types::RangeDecl(type->GetRange(), type);
+	    return Types::MakeRangeDecl(type->GetRange(), type);
 	}
     }
 
@@ -510,7 +511,7 @@ const Constants::ConstDecl* Parser::ParseConstTerm(Location loc)
 	break;
 
     case Token::Identifier:
-	if (const EnumDef* ed = GetEnumValue(CurrentToken().GetIdentName()))
+	if (const EnumDef* ed = GetEnumValue(CurrentToken().GetSymbol()))
 	{
 	    if (ed->Type()->Type() == Types::TypeDecl::TK_Boolean)
 	    {
@@ -536,7 +537,7 @@ const Constants::ConstDecl* Parser::ParseConstTerm(Location loc)
 	}
 	else
 	{
-	    if (!(cd = GetConstDecl(CurrentToken().GetIdentName())))
+	    if (!(cd = GetConstDecl(CurrentToken().GetSymbol())))
 	    {
 		NextToken();
 		return ErrorC(CurrentToken(), "Expected constant name");
@@ -827,7 +828,7 @@ Types::PointerDecl* Parser::ParsePointerType(bool maybeForwarded)
 	    // Is it a known type?
 	    if (Types::TypeDecl* ty = GetTypeDecl(name))
 	    {
-		return new Types::PointerDecl(ty);	
+		return Types::MakePointerDecl(ty);
 	    }
 	    else
 	    {
@@ -842,7 +843,7 @@ Types::PointerDecl* Parser::ParsePointerType(bool maybeForwarded)
 
     if (Types::TypeDecl* ty = ParseType("", false))
     {
-	return new Types::PointerDecl(ty);
+	return Types::MakePointerDecl(ty);
     }
     return 0;
 }
@@ -876,7 +877,7 @@ Types::ArrayDecl* Parser::ParseArrayDecl()
 	{
 	    if (Types::TypeDecl* ty = ParseType("", false))
 	    {
-		return new Types::ArrayDecl(ty, rv);
+		return Types::MakeArrayDecl(ty, rv);
 	    }
 	}
     }
@@ -1206,7 +1207,7 @@ Types::SetDecl* Parser::ParseSetDecl()
 		return reinterpret_cast<Types::SetDecl*>(ErrorT(CurrentToken(), "Set too large"));
 	    }
 	    assert(type && "Uh? Type is supposed to be set");
-	    return new Types::SetDecl(r, type);
+	    return Types::MakeSetDecl(r, type);
 	}
     }
     return 0;
@@ -1249,7 +1250,7 @@ Types::StringDecl* Parser::ParseStringDecl()
     {
 	return 0;
     }
-    return new Types::StringDecl(size);
+    return Types::MakeStringDecl(size);
 }
 
 Types::ClassDecl* Parser::ParseClassDecl(const std::string &name)
@@ -1342,7 +1343,7 @@ Types::TypeDecl* Parser::ParseType(const std::string& name, bool maybeForwarded)
     {
     case Token::Identifier:
     {
-	if (!GetEnumValue(CurrentToken().GetIdentName()))
+	if (!GetEnumValue(CurrentToken().GetSymbol()))
 	{
 	    return ParseSimpleType();
 	}
@@ -1414,9 +1415,8 @@ ExprAST* Parser::ParseIntegerExpr(Token token)
 ExprAST* Parser::ParseStringExpr(Token token)
 {
     int len =  std::max(1, (int)(token.GetStrVal().length()-1));
-    std::vector<Types::RangeDecl*> rv = {new Types::RangeDecl(new Types::Range(0, len),
-							      Types::GetIntegerType())};
-    Types::ArrayDecl *ty = new Types::ArrayDecl(Types::GetCharType(), rv);
+    std::vector<Types::RangeDecl*> rv = {Types::MakeRangeDecl(0, len, Types::GetIntegerType())};
+    Types::ArrayDecl *ty = Types::MakeArrayDecl(Types::GetCharType(), rv);
     NextToken();
     return new StringExprAST(token.Loc(), token.GetStrVal(), ty);
 }
@@ -1914,7 +1914,7 @@ bool Parser::ParseArgs(const NamedObject* def, std::vector<ExprAST*>& args)
 		{
 		    std::string idName = token.GetIdentName();
 		    NextToken();
-		    if (const NamedObject* argDef = nameStack.Find(idName))
+		    if (const NamedObject* argDef = nameStack.Find(token.GetSymbol()))
 		    {
 			if (const FuncDef *fd = llvm::dyn_cast<FuncDef>(argDef))
 			{
@@ -2072,7 +2072,7 @@ ExprAST* Parser::ParseIdentifierExpr(Token token)
 
     std::string idName = token.GetIdentName();
     AssertToken(Token::Identifier);
-    const NamedObject* def = nameStack.Find(idName);
+    const NamedObject* def = nameStack.Find(token.GetSymbol());
     if (const EnumDef *enumDef = llvm::dyn_cast_or_null<EnumDef>(def))
     {
 	return new IntegerExprAST(token.Loc(), enumDef->Value(), enumDef->Type());
@@ -2460,7 +2460,7 @@ BlockAST* Parser::ParseBlock(Location& endLoc)
 		return reinterpret_cast<BlockAST*>
 		    (Error(CurrentToken(), "Can't use label in a different scope than the declaration"));
 	    }
-	    v.push_back(new LabelExprAST(token.Loc(), { n }, 0));
+	    v.push_back(new LabelExprAST(token.Loc(), { { n, n } }, 0));
 	}
 	else if (ExprAST* ast = ParseStatement())
 	{
@@ -2675,8 +2675,9 @@ ExprAST* Parser::ParseForExpr()
 	return Error(CurrentToken(), "Expected identifier name, got " + CurrentToken().ToString());
     }
     std::string varName = CurrentToken().GetIdentName();
+    SymbolId varSym = CurrentToken().GetSymbol();
     AssertToken(Token::Identifier);
-    const NamedObject* def = nameStack.Find(varName);
+    const NamedObject* def = nameStack.Find(varSym);
     if (!def)
     {
 	return Error(CurrentToken(), "Loop variable not found");
@@ -2766,7 +2767,7 @@ ExprAST* Parser::ParseCaseExpr()
 	return 0;
     }
     std::vector<LabelExprAST*> labels;
-    std::vector<int> lab;
+    std::vector<LabelExprAST::Range> lab;
     bool isFirst = true;
     Token::TokenType prevTT;
     ExprAST* otherwise = 0;
@@ -2784,37 +2785,35 @@ ExprAST* Parser::ParseCaseExpr()
 	{
 	    return Error(CurrentToken(), "Type of case labels must not change type");
 	}
-	Token token = TranslateToken(CurrentToken());
-	switch(token.GetToken())
+	if (CurrentToken().GetToken() == Token::Else || CurrentToken().GetToken() == Token::Otherwise)
 	{
-	case Token::Char:
-	case Token::Integer:
-	    lab.push_back(token.GetIntVal());
-	    break;
-
-	case Token::Identifier:
-	    if (const EnumDef* ed = GetEnumValue(token.GetIdentName()))
-	    {
-		lab.push_back(ed->Value());
-		break;
-	    }
-	    return Error(CurrentToken(), "Expected constant or enumerated value");
-
-	case Token::Else:
-	case Token::Otherwise:
 	    if (otherwise)
 	    {
-		return Error(token, "An 'otherwise' or 'else' already used in this case block");
+		return Error(CurrentToken(), "An 'otherwise' or 'else' already used in this case block");
 	    }
 	    isOtherwise = true;
-	    break;
-
-	default:
-	    return Error(CurrentToken(), "Syntax error, expected case label");
 	}
-	if (CurrentToken().GetToken() != Token::Else && CurrentToken().GetToken() != Token::Otherwise)
+	else
 	{
-	    NextToken();
+	    // A label is a value, or a range of values: low..high.
+	    int low;
+	    if (!ParseCaseLabelValue(low))
+	    {
+		return 0;
+	    }
+	    int high = low;
+	    if (AcceptToken(Token::DotDot))
+	    {
+		if (!ParseCaseLabelValue(high))
+		{
+		    return 0;
+		}
+		if (high < low)
+		{
+		    return Error(CurrentToken(), "Case label range must not be empty");
+		}
+	    }
+	    lab.push_back(LabelExprAST::Range(low, high));
 	}
 	switch(CurrentToken().GetToken())
 	{
@@ -2856,6 +2855,34 @@ ExprAST* Parser::ParseCaseExpr()
     return new CaseExprAST(loc, expr, labels, otherwise);
 }
 
+// Integer, char or enumerated value (or constant of those) used as a case label.
+bool Parser::ParseCaseLabelValue(int& value)
+{
+    Token token = TranslateToken(CurrentToken());
+    switch(token.GetToken())
+    {
+    case Token::Char:
+    case Token::Integer:
+	value = token.GetIntVal();
+	break;
+
+    case Token::Identifier:
+	if (const EnumDef* ed = GetEnumValue(token.GetSymbol()))
+	{
+	    value = ed->Value();
+	    break;
+	}
+	Error(CurrentToken(), "Expected constant or enumerated value");
+	return false;
+
+    default:
+	Error(CurrentToken(), "Syntax error, expected case label");
+	return false;
+    }
+    NextToken();
+    return true;
+}
+
 void Parser::ExpandWithNames(const Types::FieldCollection* fields, VariableExprAST* v, int parentCount)
 {
     TRACE();
@@ -3205,7 +3232,7 @@ public:
 bool Parser::ParseProgram(ParserType type)
 {
     Token::TokenType t  = Token::Program;
-    if (type == Unit)
+    if (type != Program)
     {
 	t = Token::Unit;
     }
@@ -3244,14 +3271,20 @@ ExprAST* Parser::ParseUses()
 	    strlower(unitname);
 	    std::string path = GetPath(CurrentToken().Loc().FileName());
 	    std::string fileName = path + "/" + unitname + ".pas";
-	    FileSource source(fileName);
+	    MappedFileSource source(fileName);
 	    if (!source)
 	    {
 		return Error(CurrentToken(), "Could not open " + fileName); 
 	    }
+	    bool cached = unitCache && UnitCache::Use(fileName, UnitCache::Hash(source.Data(),
+										 source.Size()));
 	    Parser p(source);
-	    ExprAST* e = p.Parse(Unit);
+	    ExprAST* e = p.Parse(cached ? UnitInterface : Unit);
 	    errCnt += p.GetErrors();
+	    if (unitCache && !cached)
+	    {
+		UnitCache::AddStale(fileName);
+	    }
 	    if (Expect(Token::Semicolon, true))
 	    {
 		if (UnitAST *ua = llvm::dyn_cast_or_null<UnitAST>(e))
@@ -3271,7 +3304,7 @@ ExprAST* Parser::ParseUses()
     return 0;
 }
 
-bool Parser::ParseInterface(InterfaceList &iList)
+bool Parser::ParseInterface(InterfaceList &iList, ParserType type)
 {
     NameWrapper wrapper(nameStack);
     AssertToken(Token::Interface);
@@ -3305,6 +3338,13 @@ bool Parser::ParseInterface(InterfaceList &iList)
 		return false;
 	    }
 	    proto->SetIsForward(true);
+	    if (type == UnitInterface)
+	    {
+		// Implemented in the unit's object, so just declare it.
+		FunctionAST* fn = new FunctionAST(proto->Loc(), proto, {}, 0);
+		proto->SetFunction(fn);
+		ast.push_back(fn);
+	    }
 	    std::string name = proto->Name();
 	    Types::TypeDecl* ty = new Types::FunctionDecl(proto);
 	    FuncDef* nmObj = new FuncDef(name, ty, proto);
@@ -3318,6 +3358,14 @@ bool Parser::ParseInterface(InterfaceList &iList)
 	case Token::Var:
 	    if (VarDeclAST* v = ParseVarDecls())
 	    {
+		if (unitCache)
+		{
+		    v->SetUnit(moduleName);
+		    if (type == UnitInterface)
+		    {
+			v->SetImported();
+		    }
+		}
 		ast.push_back(v);
 	    }
 	    break;
@@ -3334,6 +3382,14 @@ bool Parser::ParseInterface(InterfaceList &iList)
     for(auto i : nameStack.GetLevel())
     {
 	iList.Add(i->Name(), i);
+	if (type == UnitObject && llvm::isa<TypeDef>(i))
+	{
+	    Types::ClassDecl* cd = llvm::dyn_cast<Types::ClassDecl>(i->Type());
+	    if (cd && cd->MembFuncCount())
+	    {
+		UnitCache::SetUncacheable();
+	    }
+	}
     }
     return true;
 }
@@ -3349,7 +3405,7 @@ ExprAST* Parser::ParseUnit(ParserType type)
     // The "main" of the program - we call that "__PascalMain" so we can call it from C-code.
     std::string initName = "__PascalMain";
     // In a unit, we use the moduleName to form the "init functioin" name.
-    if (type == Unit)
+    if (type != Program)
     {
 	initName = moduleName + ".init";
     }
@@ -3391,7 +3447,7 @@ ExprAST* Parser::ParseUnit(ParserType type)
 	    break;
 
 	case Token::Interface:
-	    if (!ParseInterface(interfaceList))
+	    if (!ParseInterface(interfaceList, type))
 	    {
 		return 0;
 	    }
@@ -3405,6 +3461,18 @@ ExprAST* Parser::ParseUnit(ParserType type)
 	    break;
 
 	case Token::Implementation:
+	    if (type == UnitInterface)
+	    {
+		// Precompiled units always have an init function, see below.
+		Location loc = CurrentToken().Loc();
+		PrototypeAST* proto = new PrototypeAST(loc, initName, std::vector<VarDef>(),
+						       Types::GetVoidType(), 0);
+		proto->SetIsForward(true);
+		initFunction = new FunctionAST(loc, proto, std::vector<VarDeclAST*>(), 0);
+		proto->SetFunction(initFunction);
+		finished = true;
+		break;
+	    }
 	    /* Start a new level of names */
 	    AssertToken(Token::Implementation);
 	    break;
@@ -3431,10 +3499,21 @@ ExprAST* Parser::ParseUnit(ParserType type)
 	}
 
 	case Token::End:
-	    if (type != Unit)
+	    if (type == Program)
 	    {
 		return Error(CurrentToken(), "Unexpected 'end' token");
 	    }
+	    if (unitCache)
+	    {
+		// Give the unit an (empty) init function, so a user of the precompiled
+		// unit doesn't need to know if it has one.
+		Location loc = CurrentToken().Loc();
+		PrototypeAST* proto = new PrototypeAST(loc, initName, std::vector<VarDef>(),
+						       Types::GetVoidType(), 0);
+		BlockAST* body = new BlockAST(loc, std::vector<ExprAST*>());
+		initFunction = new FunctionAST(loc, proto, std::vector<VarDeclAST*>(), body);
+		initFunction->EndLoc(loc);
+	    }
 	    AssertToken(Token::End);
 	    if (!Expect(Token::Period, true))
 	    {
@@ -3462,14 +3541,20 @@ ExprAST* Parser::Parse(ParserType type)
     TIME_TRACE();
 
     NextToken();
-    if (type == Program)
+    if (type == Program || type == UnitObject)
     {
 	VarDef input("input", Types::GetTextType(), false, true);
 	VarDef output("output", Types::GetTextType(), false, true);
 	nameStack.Add("input", new VarDef(input));
 	nameStack.Add("output", new VarDef(output));
 	std::vector<VarDef> varList{input, output};
-	ast.push_back(new VarDeclAST(Location("", 0, 0), varList));
+	VarDeclAST* v = new VarDeclAST(Location("", 0, 0), varList);
+	// A unit on its own uses the program's input and output.
+	if (type == UnitObject)
+	{
+	    v->SetImported();
+	}
+	ast.push_back(v);
     }
 
     return ParseUnit(type);
@@ -14,7 +14,9 @@ public:
     enum ParserType
     {
 	Program,
-	Unit
+	Unit,
+	UnitObject,	// Unit compiled on its own.
+	UnitInterface,	// Only the interface part of a precompiled unit.
     };
 
     class CommaConsumer
@@ -63,6 +65,7 @@ public:
     ExprAST* ParseForExpr();
     ExprAST* ParseWhile();
     ExprAST* ParseCaseExpr();
+    bool     ParseCaseLabelValue(int& value);
     ExprAST* ParseWithBlock();
     ExprAST* ParseGoto();
 
@@ -80,7 +83,7 @@ public:
     void          ParseLabels();
     ExprAST*      ParseUses();
     ExprAST*      ParseUnit(ParserType type);
-    bool          ParseInterface(InterfaceList& iList);
+    bool          ParseInterface(InterfaceList& iList, ParserType type);
 
     // Type declarations and defintitions
     void ParseTypeDef();
@@ -144,9 +147,10 @@ public:
 			  std::vector<ExprAST*>& args);
 
     // Helper functions for identifier access/checking.
-    const EnumDef* GetEnumValue(const std::string& name);
-    Types::TypeDecl* GetTypeDecl(const std::string& name);
-    const Constants::ConstDecl* GetConstDecl(const std::string& name);
+    const EnumDef* GetEnumValue(SymbolId name);
+    Types::TypeDecl* GetTypeDecl(SymbolId name);
+    Types::TypeDecl* GetTypeDecl(const std::string& name) { return GetTypeDecl(Intern(name)); }
+    const Constants::ConstDecl* GetConstDecl(SymbolId name);
     bool AddType(const std::string& name, Types::TypeDecl* type);
     bool AddConst(const std::string& name, const Constants::ConstDecl* cd);
 
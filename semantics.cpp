@@ -20,6 +20,8 @@ private:
     void CheckBuiltinExpr(BuiltinExprAST* b);
     void CheckCallExpr(CallExprAST* c);
     void CheckForExpr(ForExprAST* f);
+    void CheckLoopIndices(ForExprAST* f);
+    bool MayChange(ExprAST* e, const std::string& name);
     void CheckReadExpr(ReadAST* f);
     void CheckWriteExpr(WriteAST* f);
     void Error(const ExprAST* e, const std::string& msg) const;
@@ -54,6 +56,45 @@ void SetRangeFixup::DoIt()
     }
 }
 
+// The arrays of a loop body, and everything in it that may change a variable:
+// assignments, loops, reads, calls and builtins.
+class CollectLoopBody : public ASTVisitor
+{
+public:
+    void visit(ExprAST* e) override
+    {
+	if (ArrayExprAST* a = llvm::dyn_cast<ArrayExprAST>(e))
+	{
+	    arrays.push_back(a);
+	}
+	else if (llvm::isa<AssignExprAST>(e) || llvm::isa<ForExprAST>(e) || llvm::isa<ReadAST>(e) ||
+		 llvm::isa<CallExprAST>(e) || llvm::isa<BuiltinExprAST>(e))
+	{
+	    writers.push_back(e);
+	}
+    }
+    std::vector<ArrayExprAST*> arrays;
+    std::vector<ExprAST*>      writers;
+};
+
+// Whether a plain variable of the given name is used anywhere.
+class FindVariable : public ASTVisitor
+{
+public:
+    FindVariable(const std::string& nm) : name(nm), found(false) {}
+    void visit(ExprAST* e) override
+    {
+	found |= IsVariable(e, name);
+    }
+    static bool IsVariable(const ExprAST* e, const std::string& name)
+    {
+	return e->getKind() == ExprAST::EK_VariableExpr &&
+	    llvm::cast<VariableExprAST>(e)->Name() == name;
+    }
+    std::string name;
+    bool        found;
+};
+
 static bool isNumeric(Types::TypeDecl* t)
 {
     switch(t->Type())
@@ -91,10 +132,10 @@ static Types::RangeDecl* GetRangeDecl(Types::TypeDecl* ty)
 
     if (r->Size() > Types::SetDecl::MaxSetSize)
     {
-	r = new Types::Range(0, Types::SetDecl::MaxSetSize-1);
+	r = Types::MakeRange(0, Types::SetDecl::MaxSetSize-1);
     }
 
-    return new Types::RangeDecl(r, base);
+    return Types::MakeRangeDecl(r, base);
 }
 
 void TypeCheckVisitor::Error(const ExprAST* e, const std::string& msg) const
@@ -222,11 +263,10 @@ Types::TypeDecl* TypeCheckVisitor::BinarySetUpdate(BinaryExprAST* b)
     }
     else if (rr && lr && *rr != *lr)
     {
-	Types::Range* range = new Types::Range(std::min(lr->Start(), rr->Start()),
-					       std::max(lr->End(), rr->End()));
-
-	Types::RangeDecl* r = new Types::RangeDecl(range, rty->SubType());
-	Types::SetDecl* set = new Types::SetDecl(r, rty->SubType());
+	Types::RangeDecl* r = Types::MakeRangeDecl(std::min(lr->Start(), rr->Start()),
+						   std::max(lr->End(), rr->End()),
+						   rty->SubType());
+	Types::SetDecl* set = Types::MakeSetDecl(r, rty->SubType());
 
 	b->lhs = Recast(b->lhs, set);
 	b->rhs = Recast(b->rhs, set);
@@ -460,6 +500,28 @@ void TypeCheckVisitor::CheckSetExpr(SetExprAST* s)
     }
 }
 
+static bool ConstantValue(ExprAST* e, int64_t& value)
+{
+    if (TypeCastAST* tc = llvm::dyn_cast<TypeCastAST>(e))
+    {
+	e = tc->Expr();
+    }
+    if (IntegerExprAST* i = llvm::dyn_cast<IntegerExprAST>(e))
+    {
+	value = static_cast<int64_t>(i->Int());
+	return true;
+    }
+    return false;
+}
+
+// An index needs no range check if it is a constant within the range. Variables
+// are not trusted to be within their type, as assignments are not range checked.
+static bool IndexInRange(ExprAST* e, const Types::RangeDecl* r)
+{
+    int64_t value;
+    return ConstantValue(e, value) && value >= r->Start() && value <= r->End();
+}
+
 void TypeCheckVisitor::CheckArrayExpr(ArrayExprAST* a)
 {
     TRACE();
@@ -478,7 +540,7 @@ void TypeCheckVisitor::CheckArrayExpr(ArrayExprAST* a)
 	{
 	    Error(a, "Incorrect index type");
 	}
-	if (rangeCheck)
+	if (rangeCheck && !IndexInRange(e, r))
 	{
 	    a->indices[i] = new RangeCheckAST(e, r);
 	}
@@ -586,6 +648,83 @@ void TypeCheckVisitor::CheckForExpr(ForExprAST* f)
     {
 	Error(f, "Bad for loop");
     }
+    else if (rangeCheck)
+    {
+	CheckLoopIndices(f);
+    }
+}
+
+// Whether e may change the variable: an assignment to it, a loop or read with it, a
+// builtin such as inc given it, or any call, as the callee may change it as a global
+// or a var argument.
+bool TypeCheckVisitor::MayChange(ExprAST* e, const std::string& name)
+{
+    if (AssignExprAST* a = llvm::dyn_cast<AssignExprAST>(e))
+    {
+	return FindVariable::IsVariable(a->lhs, name);
+    }
+    if (ForExprAST* f = llvm::dyn_cast<ForExprAST>(e))
+    {
+	return FindVariable::IsVariable(f->variable, name);
+    }
+    if (ReadAST* r = llvm::dyn_cast<ReadAST>(e))
+    {
+	for(auto a : r->args)
+	{
+	    if (FindVariable::IsVariable(a, name))
+	    {
+		return true;
+	    }
+	}
+	return false;
+    }
+    if (BuiltinExprAST* b = llvm::dyn_cast<BuiltinExprAST>(e))
+    {
+	FindVariable fv(name);
+	b->accept(fv);
+	return fv.found;
+    }
+    return true;
+}
+
+// Pascal doesn't allow the body of a loop to change the control variable, but that
+// is not enforced, so only when nothing in the body may change it, and the loop has
+// constant bounds within the range of an array, indexing with it needs no check.
+void TypeCheckVisitor::CheckLoopIndices(ForExprAST* f)
+{
+    int64_t low;
+    int64_t high;
+    if (!ConstantValue(f->start, low) || !ConstantValue(f->end, high))
+    {
+	return;
+    }
+    if (f->stepDown)
+    {
+	std::swap(low, high);
+    }
+
+    CollectLoopBody body;
+    f->body->accept(body);
+    const std::string& name = f->variable->Name();
+    for(auto w : body.writers)
+    {
+	if (MayChange(w, name))
+	{
+	    return;
+	}
+    }
+    for(auto a : body.arrays)
+    {
+	for(auto& i : a->indices)
+	{
+	    RangeCheckAST* rc = llvm::dyn_cast<RangeCheckAST>(i);
+	    if (rc && FindVariable::IsVariable(rc->expr, name) &&
+		low >= rc->range->Start() && high <= rc->range->End())
+	    {
+		i = new RangeReduceAST(rc->expr, rc->range);
+	    }
+	}
+    }
 }
 
 void TypeCheckVisitor::CheckReadExpr(ReadAST* r)
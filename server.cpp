@@ -0,0 +1,253 @@
+#include "server.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// A request is the working directory and the arguments, each ending with a NUL. The
+// client's stdin, stdout and stderr are passed with the first part of it. The client
+// then shuts down its side for writing, and the server replies with the exit status.
+static const int numFds = 3;
+
+static bool MakeAddress(const std::string& socketName, sockaddr_un& addr)
+{
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socketName.size() >= sizeof(addr.sun_path))
+    {
+	std::cerr << "Socket name too long: " << socketName << std::endl;
+	return false;
+    }
+    strcpy(addr.sun_path, socketName.c_str());
+    return true;
+}
+
+static bool WriteAll(int fd, const char* data, size_t size)
+{
+    while(size)
+    {
+	ssize_t n = write(fd, data, size);
+	if (n < 0 && errno == EINTR)
+	{
+	    continue;
+	}
+	if (n <= 0)
+	{
+	    return false;
+	}
+	data += n;
+	size -= n;
+    }
+    return true;
+}
+
+static bool ReceiveRequest(int conn, int fds[numFds], std::vector<std::string>& request)
+{
+    char buffer[4096];
+    iovec iov = { buffer, sizeof(buffer) };
+    char control[CMSG_SPACE(sizeof(int) * numFds)];
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t n = recvmsg(conn, &msg, 0);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (n <= 0 || !cmsg || cmsg->cmsg_type != SCM_RIGHTS ||
+	cmsg->cmsg_len != CMSG_LEN(sizeof(int) * numFds))
+    {
+	return false;
+    }
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * numFds);
+
+    std::string data(buffer, n);
+    while((n = read(conn, buffer, sizeof(buffer))) > 0 || (n < 0 && errno == EINTR))
+    {
+	if (n > 0)
+	{
+	    data.append(buffer, n);
+	}
+    }
+    if (n < 0 || data.empty() || data.back() != '\0')
+    {
+	return false;
+    }
+    for(size_t start = 0; start < data.size();)
+    {
+	size_t end = data.find('\0', start);
+	request.push_back(data.substr(start, end - start));
+	start = end + 1;
+    }
+    return true;
+}
+
+// Compile in a child process, so that the status gets back to the client even if
+// the compile calls exit.
+static int HandleRequest(int conn, std::function<int(const std::vector<std::string>&)> compile)
+{
+    int fds[numFds];
+    std::vector<std::string> request;
+    if (!ReceiveRequest(conn, fds, request))
+    {
+	std::cerr << "Bad request to compile server" << std::endl;
+	return 1;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+	close(conn);
+	for(int i = 0; i < numFds; i++)
+	{
+	    dup2(fds[i], i);
+	    close(fds[i]);
+	}
+	if (chdir(request[0].c_str()) != 0)
+	{
+	    std::cerr << "Could not change directory to " << request[0] << std::endl;
+	    exit(1);
+	}
+	exit(compile(std::vector<std::string>(request.begin() + 1, request.end())));
+    }
+    for(int i = 0; i < numFds; i++)
+    {
+	close(fds[i]);
+    }
+
+    int status = 1;
+    if (pid > 0)
+    {
+	int waitStatus;
+	while(waitpid(pid, &waitStatus, 0) < 0 && errno == EINTR)
+	{
+	}
+	status = (WIFEXITED(waitStatus) ? WEXITSTATUS(waitStatus) : 1);
+    }
+    WriteAll(conn, reinterpret_cast<const char*>(&status), sizeof(status));
+    close(conn);
+    return 0;
+}
+
+int RunServer(const std::string& socketName,
+	      std::function<int(const std::vector<std::string>&)> compile)
+{
+    sockaddr_un addr;
+    if (!MakeAddress(socketName, addr))
+    {
+	return 1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socketName.c_str());
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+	listen(fd, SOMAXCONN) < 0)
+    {
+	std::cerr << "Could not listen on " << socketName << ": " << strerror(errno) << std::endl;
+	return 1;
+    }
+
+    // Request handlers are not waited for.
+    signal(SIGCHLD, SIG_IGN);
+    for(;;)
+    {
+	int conn = accept(fd, 0, 0);
+	if (conn < 0)
+	{
+	    if (errno == EINTR || errno == ECONNABORTED)
+	    {
+		continue;
+	    }
+	    std::cerr << "Compile server: " << strerror(errno) << std::endl;
+	    return 1;
+	}
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+	    close(fd);
+	    signal(SIGCHLD, SIG_DFL);
+	    exit(HandleRequest(conn, compile));
+	}
+	if (pid < 0)
+	{
+	    std::cerr << "Compile server could not start request: " << strerror(errno) << std::endl;
+	}
+	close(conn);
+    }
+}
+
+int RunClient(const std::string& socketName, const std::vector<std::string>& args)
+{
+    sockaddr_un addr;
+    if (!MakeAddress(socketName, addr))
+    {
+	return 1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+    {
+	std::cerr << "Could not connect to " << socketName << ": " << strerror(errno) << std::endl;
+	return 1;
+    }
+
+    char* cwd = getcwd(0, 0);
+    if (!cwd)
+    {
+	std::cerr << "Could not get current directory" << std::endl;
+	return 1;
+    }
+    std::string data = std::string(cwd) + '\0';
+    free(cwd);
+    for(auto& a : args)
+    {
+	data += a + '\0';
+    }
+
+    int fds[numFds] = { 0, 1, 2 };
+    iovec iov = { &data[0], data.size() };
+    char control[CMSG_SPACE(sizeof(fds))];
+    memset(control, 0, sizeof(control));
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    ssize_t n = sendmsg(fd, &msg, 0);
+    if (n <= 0 || !WriteAll(fd, data.data() + n, data.size() - n) || shutdown(fd, SHUT_WR) < 0)
+    {
+	std::cerr << "Could not send request to " << socketName << std::endl;
+	return 1;
+    }
+
+    int status;
+    size_t got = 0;
+    while(got < sizeof(status))
+    {
+	n = read(fd, reinterpret_cast<char*>(&status) + got, sizeof(status) - got);
+	if (n < 0 && errno == EINTR)
+	{
+	    continue;
+	}
+	if (n <= 0)
+	{
+	    std::cerr << "Lost connection to compile server" << std::endl;
+	    return 1;
+	}
+	got += n;
+    }
+    close(fd);
+    return status;
+}
@@ -0,0 +1,19 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Compile server, to save starting the compiler and initializing LLVM for every file.
+// The server listens on a Unix socket. A client sends the arguments and working
+// directory of a compile, along with its stdin, stdout and stderr, and gets the exit
+// status back. Each request is compiled in a process forked from the server, so
+// several can run at once, and all start with the targets and builtins set up.
+int RunServer(const std::string& socketName,
+	      std::function<int(const std::vector<std::string>&)> compile);
+
+// Send a compile to the server, returning its exit status.
+int RunClient(const std::string& socketName, const std::vector<std::string>& args);
+
+#endif
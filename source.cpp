@@ -1,4 +1,12 @@
 #include "source.h"
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 char FileSource::Get()
 {
@@ -14,3 +22,78 @@ char FileSource::Get()
     }
     return ch;
 }
+
+MappedFileSource::MappedFileSource(const std::string &name)
+    : file(GetFileId(name)), data(0), size(0), pos(0), isOpen(false), isMapped(false), lineStarts(1, 0),
+      scanned(0)
+{
+    int fd = open(name.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+	return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+	void* p = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (p != MAP_FAILED)
+	{
+	    madvise(p, st.st_size, MADV_SEQUENTIAL);
+	    data = static_cast<const char*>(p);
+	    size = st.st_size;
+	    isMapped = true;
+	}
+    }
+    close(fd);
+
+    if (!isMapped)
+    {
+	// Not mappable (empty file, pipe, etc) - read it the old-fashioned way.
+	std::ifstream input(name, std::ios::binary);
+	if (!input)
+	{
+	    return;
+	}
+	std::stringstream ss;
+	ss << input.rdbuf();
+	buffer = ss.str();
+	data = buffer.data();
+	size = buffer.size();
+    }
+    isOpen = true;
+}
+
+MappedFileSource::~MappedFileSource()
+{
+    if (isMapped)
+    {
+	munmap(const_cast<char*>(data), size);
+    }
+}
+
+// Return the index of the line containing offset, scanning forward for newlines as
+// needed. Each byte of the file is scanned at most once.
+size_t MappedFileSource::LineIndex(size_t offset) const
+{
+    size_t limit = std::min(offset, size);
+    while (scanned < limit)
+    {
+	const void* nl = memchr(data + scanned, '\n', limit - scanned);
+	if (!nl)
+	{
+	    scanned = limit;
+	    break;
+	}
+	scanned = static_cast<const char*>(nl) - data + 1;
+	lineStarts.push_back(scanned);
+    }
+    // Last line starting at or before offset.
+    auto it = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset);
+    return std::distance(lineStarts.begin(), it) - 1;
+}
+
+Location MappedFileSource::LocationAt(size_t offset) const
+{
+    size_t line = LineIndex(offset);
+    return Location(file, line + 1, offset - lineStarts[line] + 1);
+}
@@ -3,7 +3,9 @@
 
 #include "location.h"
 #include <fstream>
+#include <cstdio>
 #include <string>
+#include <vector>
 
 class Source
 {
@@ -12,22 +14,71 @@ public:
     virtual char Get() = 0;
     virtual operator bool () const = 0;
     virtual operator Location () const = 0;
+    // Sources that hold the whole input in memory return it here, so the lexer
+    // can scan the buffer directly instead of calling Get() for each character.
+    virtual const char* Data() const { return 0; }
+    virtual size_t Size() const { return 0; }
+    virtual Location LocationAt(size_t /*offset*/) const { return *this; }
 };
 
 class FileSource : public Source
 {
 public:
     FileSource(const std::string &name) 
-	: name(name), input(name), column(1), lineNo(1) { }
+	: file(GetFileId(name)), input(name), column(1), lineNo(1) { }
     char Get() override;
     operator bool() const override { return (bool)input; }
-    operator Location() const override { return Location(name, lineNo, column); }
+    operator Location() const override { return Location(file, lineNo, column); }
     
 private:
-    std::string name;
+    FileId file;
     std::ifstream input;
     uint32_t column;
     uint32_t lineNo;
 };
 
+// Source that holds the whole file in memory - mmap'ed if possible, otherwise read in
+// one go. Line and column are not tracked per character, but calculated from the
+// byte offset when a location is asked for.
+class MappedFileSource : public Source
+{
+public:
+    MappedFileSource(const std::string &name);
+    ~MappedFileSource();
+    char Get() override
+    {
+	if (pos < size)
+	{
+	    return data[pos++];
+	}
+	pos++;
+	return EOF;
+    }
+    operator bool() const override { return isOpen; }
+    operator Location() const override { return LocationAt(pos); }
+
+    const char* Data() const override { return data; }
+    size_t Size() const override { return size; }
+    size_t Offset() const { return pos; }
+    Location LocationAt(size_t offset) const override;
+
+private:
+    MappedFileSource(const MappedFileSource&) = delete;
+    MappedFileSource& operator=(const MappedFileSource&) = delete;
+
+    size_t LineIndex(size_t offset) const;
+
+private:
+    FileId      file;
+    const char* data;
+    size_t      size;
+    size_t      pos;
+    bool        isOpen;
+    bool        isMapped;
+    std::string buffer;
+    // Offsets of the start of each line, filled in as far as has been asked for.
+    mutable std::vector<size_t> lineStarts;
+    mutable size_t              scanned;
+};
+
 #endif
@@ -1,20 +1,13 @@
 #include "stack.h"
-#include "utils.h"
 
-bool InterfaceList::Add(std::string name, const NamedObject* obj) 
+bool InterfaceList::Add(SymbolId name, const NamedObject* obj) 
 {
-    if (caseInsensitive)
-    {
-	strlower(name);
-    }
-    auto it = list.find(name);
-    if (it == list.end())
+    if (list.insert(std::make_pair(name, obj)).second)
     {
 	if (verbosity > 1)
 	{
-	    std::cerr << "Adding value: " << name << std::endl;
+	    std::cerr << "Adding value: " << SymbolName(name) << std::endl;
 	}
-	list[name] = obj;
 	return true;
     }
     return false;
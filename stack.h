@@ -3,104 +3,123 @@
 
 #include "options.h"
 #include "namedobject.h"
-#include "utils.h"
-#include <deque>
-#include <map>
+#include "symbol.h"
+#include <unordered_map>
 #include <string>
 #include <iostream>
 #include <vector>
 
+// Scoped symbol table. All levels share one open-addressing hash table, which
+// maps a name to the most recent definition of it. Each definition links to the
+// one it shadows, and definitions are kept in the order they were added, so
+// dropping a level just walks back over that level's definitions and restores
+// what they shadowed.
 template <typename T>
 class Stack
 {
 public:
     // Expose this so we can use it as InterfaceList for example.
-    typedef std::map<std::string, T> MapType;
+    typedef std::unordered_map<SymbolId, T> MapType;
 private:
-    typedef typename MapType::const_iterator MapIter;
-    typedef std::deque<MapType> StackType;
-    typedef typename StackType::const_reverse_iterator StackRIter;
+    static const int      None = -1;
+    static const SymbolId NoName = ~0u;
+    struct Entry
+    {
+	SymbolId name;
+	T        value;
+	size_t   level;
+	int      shadowed;
+    };
+    struct Slot
+    {
+	SymbolId name;
+	int      head;
+    };
 public:
-    Stack() { NewLevel(); }
+    Stack() : slots(16, Slot { NoName, None }), used(0) { NewLevel(); }
     void NewLevel() 
     { 
-	stack.push_back(MapType()); 
+	levels.push_back(entries.size());
     }
 
     size_t MaxLevel() const
     {
-	return stack.size()-1;
+	return levels.size()-1;
     }
 
     std::vector<T> GetLevel()
     {
-	std::vector<T> v;
-	for(auto i : stack.back())
-	{
-	    v.push_back(i.second);
-	}
-	return v;
+	return GetLevel(MaxLevel());
     }
 
-    std::vector<T> GetLevel(int n)
+    std::vector<T> GetLevel(size_t n)
     {
 	std::vector<T> v;
-	assert(n < stack.size() && "Requests for getlevel should be in bounds...");
-	for(auto i : stack[n])
+	for(auto e : GetLevelEntries(n))
 	{
-	    v.push_back(i.second);
+	    v.push_back(e.value);
 	}
 	return v;
     }
 
     void DropLevel() 
     { 
-	stack.pop_back(); 
+	for(size_t i = entries.size(); i > levels.back(); i--)
+	{
+	    const Entry& e = entries.back();
+	    slots[Lookup(e.name)].head = e.shadowed;
+	    entries.pop_back();
+	}
+	levels.pop_back();
     }
 
     /* Returns false on failure */
-    bool Add(std::string name, const T v) 
+    bool Add(SymbolId name, const T v) 
     {
-	if (caseInsensitive)
+	size_t slot = Lookup(name);
+	int head = slots[slot].head;
+	if (head != None && entries[head].level == MaxLevel())
 	{
-	    strlower(name);
+	    return false;
 	}
-	MapIter it = stack.back().find(name);
-	if (it == stack.back().end())
+	if (verbosity > 1)
 	{
-	    if (verbosity > 1)
-	    {
-		std::cerr << "Adding value: " << name << std::endl;
-	    }
-	    stack.back()[name] = v;
-	    return true;
+	    std::cerr << "Adding value: " << SymbolName(name) << std::endl;
+	}
+	if (slots[slot].name == NoName)
+	{
+	    slots[slot].name = name;
+	    used++;
+	}
+	slots[slot].head = entries.size();
+	entries.push_back(Entry { name, v, MaxLevel(), head });
+	if (used * 2 > slots.size())
+	{
+	    Grow();
 	}
-	return false;
+	return true;
+    }
+
+    bool Add(const std::string& name, const T v) 
+    {
+	return Add(Intern(name), v);
     }
 
-    T Find(std::string name, size_t& level) const
+    T Find(SymbolId name, size_t& level) const
     {
-	int lvl = MaxLevel();
 	if (verbosity > 1)
 	{
-	    std::cerr << "Finding value: " << name << std::endl;
+	    std::cerr << "Finding value: " << SymbolName(name) << std::endl;
 	}
-	if (caseInsensitive)
+	int head = slots[Lookup(name)].head;
+	if (head != None)
 	{
-	    strlower(name);
-	}
-	for(StackRIter s = stack.rbegin(); s != stack.rend(); s++, lvl--)
-	{
-	    MapIter it = s->find(name);
-	    if (it != s->end())
+	    level = entries[head].level;
+	    if (verbosity > 1)
 	    {
-		level = lvl;
-		if (verbosity > 1)
-		{
-		    std::cerr << "Found at lvl " << lvl << std::endl;
-		}
-		return it->second;
+		std::cerr << "Found at lvl " << level << std::endl;
 	    }
+	    return entries[head].value;
 	}
 	if (verbosity > 1)
 	{
@@ -110,44 +129,107 @@ public:
 	return 0;
     }
 
-    T Find(const std::string& name) 
+    T Find(const std::string& name, size_t& level) const
+    {
+	return Find(Intern(name), level);
+    }
+
+    T Find(SymbolId name) 
     {
 	size_t dummy;
 	return Find(name, dummy);
     }
 
-    T FindTopLevel(std::string name)
+    T Find(const std::string& name) 
+    {
+	return Find(Intern(name));
+    }
+
+    T FindTopLevel(SymbolId name)
     {
-	if (caseInsensitive)
+	int head = slots[Lookup(name)].head;
+	if (head != None && entries[head].level == MaxLevel())
 	{
-	    strlower(name);
+	    return entries[head].value;
 	}
-	MapIter it = stack.back().find(name);
-	if (it != stack.back().end())
+	return 0;
+    }
+
+    T FindTopLevel(const std::string& name)
+    {
+	return FindTopLevel(Intern(name));
+    }
+
+    T FindBottomLevel(SymbolId name)
+    {
+	for(int i = slots[Lookup(name)].head; i != None; i = entries[i].shadowed)
 	{
-	    return it->second;
+	    if (entries[i].level == 0)
+	    {
+		return entries[i].value;
+	    }
 	}
 	return 0;
     }
 
-    T FindBottomLevel(std::string name)
+    T FindBottomLevel(const std::string& name)
+    {
+	return FindBottomLevel(Intern(name));
+    }
+
+    void dump(std::ostream& out) const;
+    void dump() const { dump(std::cerr); }
+private:
+    // Index of the slot for name, or the empty slot where it would go. A slot
+    // keeps its name when the last definition is dropped, so probe sequences are
+    // never broken; such slots are cleared out when the table is rebuilt.
+    size_t Lookup(SymbolId name) const
+    {
+	size_t mask = slots.size() - 1;
+	for(size_t i = (name * 0x9E3779B1u) & mask;; i = (i + 1) & mask)
+	{
+	    const Slot& s = slots[i];
+	    if (s.name == name || s.name == NoName)
+	    {
+		return i;
+	    }
+	}
+    }
+
+    std::vector<Entry> GetLevelEntries(size_t n) const
     {
-	if (caseInsensitive)
+	assert(n < levels.size() && "Requests for getlevel should be in bounds...");
+	size_t end = (n + 1 < levels.size()) ? levels[n + 1] : entries.size();
+	return std::vector<Entry>(entries.begin() + levels[n], entries.begin() + end);
+    }
+
+    void Grow()
+    {
+	size_t live = 0;
+	for(auto s : slots)
 	{
-	    strlower(name);
+	    live += (s.head != None);
 	}
-	MapIter it = stack.front().find(name);
-	if (it != stack.front().end())
+	std::vector<Slot> old;
+	old.swap(slots);
+	slots.assign((live * 4 > old.size()) ? old.size() * 2 : old.size(), Slot { NoName, None });
+	used = 0;
+	for(auto s : old)
 	{
-	    return it->second;
+	    if (s.head != None)
+	    {
+		slots[Lookup(s.name)] = s;
+		used++;
+	    }
 	}
-	return 0;
     }
 
-    void dump(std::ostream& out) const;
-    void dump() const { dump(std::cerr); }
 private:
-    StackType stack;
+    std::vector<Slot>   slots;
+    size_t              used;
+    std::vector<Entry>  entries;
+    // Index into entries where each level starts.
+    std::vector<size_t> levels;
 };
 
 template <typename T>
@@ -169,15 +251,13 @@ private:
 template <typename T>
 void Stack<T>::dump(std::ostream& out) const
 {
-    int n = 0;
-    for(auto s : stack)
+    for(size_t n = 0; n < levels.size(); n++)
     {
 	out << "Level " << n << std::endl;
-	n++;
-	for(auto v : s)
+	for(auto v : GetLevelEntries(n))
 	{
-	    out << v.first << ": ";
-	    v.second->dump(out);
+	    out << SymbolName(v.name) << ": ";
+	    v.value->dump(out);
 	    out << std::endl;
 	}
     }
@@ -187,7 +267,8 @@ class InterfaceList
 {
 public:
     InterfaceList() {};
-    bool Add(std::string name, const NamedObject* obj);
+    bool Add(SymbolId name, const NamedObject* obj);
+    bool Add(const std::string& name, const NamedObject* obj) { return Add(Intern(name), obj); }
     const Stack<const NamedObject*>::MapType& List() const { return list; }
 private:
     Stack<const NamedObject*>::MapType list;
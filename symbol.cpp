@@ -0,0 +1,56 @@
+#include "symbol.h"
+#include "options.h"
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/SmallString.h>
+#include <cctype>
+#include <deque>
+
+class SymbolTable
+{
+public:
+    SymbolId Intern(llvm::StringRef name)
+    {
+	auto res = ids.insert(std::make_pair(name, static_cast<SymbolId>(names.size())));
+	if (res.second)
+	{
+	    names.push_back(name.str());
+	}
+	return res.first->second;
+    }
+
+    const std::string& Name(SymbolId id) const
+    {
+	assert(id < names.size() && "Invalid symbol id");
+	return names[id];
+    }
+
+private:
+    llvm::StringMap<SymbolId> ids;
+    std::deque<std::string>   names;
+};
+
+static SymbolTable& Symbols()
+{
+    static SymbolTable symbols;
+    return symbols;
+}
+
+SymbolId Intern(const char* str, size_t len)
+{
+    if (!caseInsensitive)
+    {
+	return Symbols().Intern(llvm::StringRef(str, len));
+    }
+    llvm::SmallString<32> lower;
+    lower.resize(len);
+    for(size_t i = 0; i < len; i++)
+    {
+	lower[i] = ::tolower(static_cast<unsigned char>(str[i]));
+    }
+    return Symbols().Intern(lower.str());
+}
+
+const std::string& SymbolName(SymbolId id)
+{
+    return Symbols().Name(id);
+}
@@ -0,0 +1,17 @@
+#ifndef SYMBOL_H
+#define SYMBOL_H
+
+#include <string>
+#include <cstdint>
+
+// Identifiers are interned into a global table, so that the same name (after
+// case-folding if caseInsensitive is set) always gets the same SymbolId.
+// Comparing and hashing names is then just integer operations.
+typedef uint32_t SymbolId;
+
+SymbolId Intern(const char* str, size_t len);
+inline SymbolId Intern(const std::string& str) { return Intern(str.data(), str.size()); }
+// The (case-folded) name of an interned symbol.
+const std::string& SymbolName(SymbolId id);
+
+#endif
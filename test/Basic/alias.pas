@@ -0,0 +1,61 @@
+program alias;
+
+type
+   rec	 = record
+	      a, b : integer;
+	   end;
+   prec	 = ^rec;
+   chars = record
+	      case boolean of
+		true  : (i : integer);
+		false : (c : array [1..4] of char);
+	   end;
+   ptrs	 = record
+	      case boolean of
+		true  : (ip : ^integer);
+		false : (rp : ^real);
+	   end;
+
+var
+   n	: integer;
+   f	: real;
+   r	: rec;
+   p, q	: prec;
+   u	: chars;
+   v	: ptrs;
+
+procedure scale(var x : integer; var y : real);
+begin
+   x := x * 2;
+   y := y * x;
+end;
+
+procedure bump(r : rec);
+begin
+   r.a := r.a + 100;
+   writeln('inside ', r.a);
+end;
+
+begin
+   n := 3;
+   f := 1.5;
+   scale(n, f);
+   writeln(n:3, f:6:1);
+   r.a := 1;
+   r.b := 2;
+   bump(r);
+   writeln(r.a, ' ', r.b);
+   new(p);
+   q := p;
+   p^.a := 5;
+   q^.a := q^.a + 1;
+   writeln(p^.a);
+   u.i := 65;
+   writeln(u.c[1]);
+   u.c[1] := 'B';
+   writeln(u.i);
+   new(v.rp);
+   v.ip^ := 5;
+   v.rp^ := 0.0;
+   writeln(v.ip^);
+end.
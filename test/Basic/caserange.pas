@@ -0,0 +1,65 @@
+program caserange;
+
+type
+   colour = (red, orange, yellow, green, blue, indigo, violet);
+
+var
+   i : integer;
+   c : char;
+   k : colour;
+
+procedure classify(n : integer);
+begin
+   case n of
+     0		  : writeln(n:6, ' zero');
+     1..9	  : writeln(n:6, ' digit');
+     10, 12..15	  : writeln(n:6, ' teens');
+     100..999	  : writeln(n:6, ' hundreds');
+     1000..99999  : writeln(n:6, ' thousands');
+     100000	  : writeln(n:6, ' hundred thousand');
+     200000..300000 : writeln(n:6, ' wide');
+     otherwise	    writeln(n:6, ' other');
+   end;
+end;
+
+procedure letter(c : char);
+begin
+   case c of
+     'a'..'z' : writeln(c, ' lower');
+     'A'..'Z' : writeln(c, ' upper');
+     '0'..'9' : writeln(c, ' digit');
+     otherwise  writeln(c, ' other');
+   end;
+end;
+
+begin
+   for i := 0 to 16 do
+      classify(i);
+   classify(99);
+   classify(100);
+   classify(999);
+   classify(1000);
+   classify(99999);
+   classify(100000);
+   classify(100001);
+   classify(199999);
+   classify(200000);
+   classify(250000);
+   classify(300000);
+   classify(300001);
+   classify(-1);
+   letter('a');
+   letter('q');
+   letter('z');
+   letter('A');
+   letter('Z');
+   letter('5');
+   letter('@');
+   letter('{');
+   for k := red to violet do
+      case k of
+	red..yellow  : writeln('warm');
+	green	     : writeln('green');
+	blue..violet : writeln('cool');
+      end;
+end.
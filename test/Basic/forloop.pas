@@ -0,0 +1,42 @@
+program forloop;
+
+var
+   i, j	  : integer;
+   n, sum : integer;
+   c	  : char;
+
+begin
+   n := 0;
+   for i := 5 to 1 do
+      n := n + 1;
+   for i := 1 downto 5 do
+      n := n + 1;
+   writeln('empty ', n);
+   sum := 0;
+   for i := 1 to 100 do
+      sum := sum + i;
+   writeln('up ', sum);
+   sum := 0;
+   for i := 100 downto 1 do
+      sum := sum + i;
+   writeln('down ', sum);
+   n := 0;
+   for i := -3 to 3 do
+      for j := i to 3 do
+	 n := n + 1;
+   writeln('nested ', n);
+   n := 3;
+   sum := 0;
+   for i := 1 to n do
+   begin
+      n := n + 1;
+      sum := sum + i;
+   end;
+   writeln('bounds ', sum, ' ', n);
+   for i := maxint - 2 to maxint do
+      write(maxint - i:2);
+   writeln;
+   for c := 'z' downto 'u' do
+      write(c);
+   writeln;
+end.
@@ -0,0 +1,18 @@
+program rangeconst;
+
+var
+   a   : array [1..10] of integer;
+   b   : array [0..9] of integer;
+   i   : integer;
+   sum : integer;
+
+begin
+   for i := 1 to 10 do
+      a[i] := i * i;
+   for i := 9 downto 0 do
+      b[i] := i * 3;
+   sum := a[1] + a[10] + b[0] + b[9];
+   for i := 10 downto 1 do
+      sum := sum + a[i];
+   writeln('sum ', sum);
+end.
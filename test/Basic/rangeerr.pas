@@ -0,0 +1,13 @@
+program rangeerr;
+
+var
+   a : array [1..10] of integer;
+   j : 1..10;
+   n : integer;
+
+begin
+   n := 20;
+   j := n;
+   a[j] := 1;
+   writeln('not reached ', a[1]);
+end.
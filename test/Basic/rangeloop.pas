@@ -0,0 +1,57 @@
+program rangeloop;
+
+type
+   colour = (red, orange, yellow, green, blue, indigo, violet);
+   small  = 1..10;
+
+var
+   a	 : array [1..10] of integer;
+   b	 : array [0..19] of integer;
+   count : array [colour] of integer;
+   freq	 : array [char] of integer;
+   s	 : small;
+   i, j	 : integer;
+   n	 : integer;
+   k	 : colour;
+   c	 : char;
+   sum	 : integer;
+
+begin
+   for i := 1 to 10 do
+      a[i] := i * i;
+   for i := 10 downto 1 do
+      b[i * 2 - 2] := a[i];
+   for i := 0 to 19 do
+      if odd(i) then
+	 b[i] := -b[i - 1];
+   sum := 0;
+   for s := 1 to 10 do
+      sum := sum + a[s];
+   writeln('sum ', sum);
+   n := 20;
+   sum := 0;
+   for i := 0 to n - 1 do
+      sum := sum + b[i];
+   writeln('total ', sum);
+   j := 7;
+   sum := 0;
+   for i := 1 to 10 do
+      sum := sum + a[j] + a[i];
+   writeln('invariant ', sum);
+   for k := red to violet do
+      count[k] := ord(k) * 10;
+   for k := violet downto red do
+      write(count[k]:4);
+   writeln;
+   for c := chr(0) to chr(255) do
+      freq[c] := 0;
+   for i := 0 to 9 do
+   begin
+      c := chr(ord('a') + (i * 3) mod 7);
+      freq[c] := freq[c] + 1;
+   end;
+   for c := 'a' to 'z' do
+      if freq[c] > 0 then
+	 write(c, freq[c]:2, ' ');
+   writeln;
+end.
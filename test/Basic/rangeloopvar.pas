@@ -0,0 +1,19 @@
+program rangeloopvar;
+
+var
+   a : array [1..10] of integer;
+   i : integer;
+
+procedure skip(var x : integer);
+begin
+   x := x + 19;
+end;
+
+begin
+   for i := 1 to 10 do
+   begin
+      skip(i);
+      a[i] := 1;
+   end;
+   writeln('not reached ', a[1]);
+end.
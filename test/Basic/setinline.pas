@@ -0,0 +1,13 @@
+program setinline;
+
+type
+   letters = set of char;
+
+var
+   a, b : letters;
+
+begin
+   a := ['a', 'b'];
+   b := ['a'..'z'];
+   writeln(a <= b, ' ', b <= a, ' ', a = b);
+end.
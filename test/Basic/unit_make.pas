@@ -0,0 +1,18 @@
+program unitmake;
+
+uses unit_make1, unit_make2;
+
+var
+   files : integer;
+
+procedure hello;
+begin
+   writeln('Hello from the program');
+end;
+
+begin
+   files := 3;
+   hello;
+   hello1(files);
+   hello2(files + 1);
+end.
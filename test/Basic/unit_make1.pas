@@ -0,0 +1,12 @@
+unit unit_make1;
+
+interface
+procedure hello1(n : integer);
+
+implementation
+procedure hello1(n : integer);
+begin
+   writeln('Hello ', n:1, ' from unit 1');
+end;
+
+end.
@@ -0,0 +1,12 @@
+unit unit_make2;
+
+interface
+procedure hello2(n : integer);
+
+implementation
+procedure hello2(n : integer);
+begin
+   writeln('Hello ', n:1, ' from unit 2');
+end;
+
+end.
@@ -0,0 +1,7 @@
+  6   9.0
+inside 101
+1 2
+6
+A
+66
+0
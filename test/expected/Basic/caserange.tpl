@@ -0,0 +1,45 @@
+     0 zero
+     1 digit
+     2 digit
+     3 digit
+     4 digit
+     5 digit
+     6 digit
+     7 digit
+     8 digit
+     9 digit
+    10 teens
+    11 other
+    12 teens
+    13 teens
+    14 teens
+    15 teens
+    16 other
+    99 other
+   100 hundreds
+   999 hundreds
+  1000 thousands
+ 99999 thousands
+100000 hundred thousand
+100001 other
+199999 other
+200000 wide
+250000 wide
+300000 wide
+300001 other
+    -1 other
+a lower
+q lower
+z lower
+A upper
+Z upper
+5 digit
+@ other
+{ other
+warm
+warm
+warm
+green
+cool
+cool
+cool
@@ -0,0 +1,7 @@
+empty 0
+up 5050
+down 5050
+nested 28
+bounds 6 6
+ 2 1 0
+zyxwvu
@@ -0,0 +1 @@
+Basic/rangeerr.pas:11: Out of range [expected: 1..10, got 20]
@@ -0,0 +1,5 @@
+sum 385
+total 0
+invariant 875
+  60  50  40  30  20  10   0
+a 2 b 1 c 1 d 2 e 1 f 1 g 2 
@@ -0,0 +1 @@
+Basic/rangeloopvar.pas:16: Out of range [expected: 1..10, got 20]
@@ -0,0 +1 @@
+TRUE FALSE FALSE
@@ -0,0 +1,3 @@
+Hello from the program
+Hello 3 from unit 1
+Hello 4 from unit 2
@@ -0,0 +1,144 @@
+// Microbenchmark for the scoped symbol table in stack.h, compared with the
+// deque-of-std::map implementation it replaced (kept here as MapStack).
+#include "../stack.h"
+#include "../utils.h"
+#include <chrono>
+#include <deque>
+#include <map>
+#include <random>
+
+int  verbosity = 0;
+bool caseInsensitive = true;
+
+struct Value
+{
+    int n;
+    void dump(std::ostream& out) const { out << n; }
+};
+
+template <typename T>
+class MapStack
+{
+public:
+    MapStack() { NewLevel(); }
+    void NewLevel() { stack.push_back(std::map<std::string, T>()); }
+    void DropLevel() { stack.pop_back(); }
+    bool Add(std::string name, const T v)
+    {
+	strlower(name);
+	return stack.back().insert(std::make_pair(name, v)).second;
+    }
+    T Find(std::string name) const
+    {
+	strlower(name);
+	for(auto s = stack.rbegin(); s != stack.rend(); s++)
+	{
+	    auto it = s->find(name);
+	    if (it != s->end())
+	    {
+		return it->second;
+	    }
+	}
+	return 0;
+    }
+private:
+    std::deque<std::map<std::string, T>> stack;
+};
+
+// Global names as from a few big units, then nested functions each with some
+// locals, with lookups from the innermost scope.
+const int Globals = 20000;
+const int Depth = 8;
+const int Locals = 30;
+const int Rounds = 200;
+const int LookupsPerScope = 200;
+
+struct Workload
+{
+    std::vector<std::string> names;
+    std::vector<SymbolId>    ids;
+    std::vector<int>         lookups;
+};
+
+static Workload MakeWorkload()
+{
+    Workload w;
+    std::mt19937 rng(4711);
+    for(int i = 0; i < Globals + Depth * Locals; i++)
+    {
+	w.names.push_back("Name_" + std::to_string(rng() % 100000) + "_" + std::to_string(i));
+	w.ids.push_back(Intern(w.names.back()));
+    }
+    for(int i = 0; i < LookupsPerScope; i++)
+    {
+	// Mostly locals, some globals - and every name in range exists.
+	w.lookups.push_back((i % 4) ? Globals + rng() % (Depth * Locals) : rng() % Globals);
+    }
+    return w;
+}
+
+template <typename S, typename Names>
+static long Run(S& s, const Names& names, const std::vector<int>& lookups, double& secs)
+{
+    Value* values = new Value[names.size()];
+    long found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < Globals; i++)
+    {
+	s.Add(names[i], &values[i]);
+    }
+    for(int r = 0; r < Rounds; r++)
+    {
+	for(int d = 0; d < Depth; d++)
+	{
+	    s.NewLevel();
+	    for(int i = 0; i < Locals; i++)
+	    {
+		int idx = Globals + d * Locals + i;
+		s.Add(names[idx], &values[idx]);
+	    }
+	    for(auto l : lookups)
+	    {
+		if (Value* v = s.Find(names[l]))
+		{
+		    found += v - values;
+		}
+	    }
+	}
+	for(int d = 0; d < Depth; d++)
+	{
+	    s.DropLevel();
+	}
+    }
+    secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    delete [] values;
+    return found;
+}
+
+int main()
+{
+    Workload w = MakeWorkload();
+    double mapTime, stackTime, stringTime;
+
+    MapStack<Value*> ms;
+    long mapFound = Run(ms, w.names, w.lookups, mapTime);
+    Stack<Value*> st;
+    long stackFound = Run(st, w.ids, w.lookups, stackTime);
+    Stack<Value*> ss;
+    long stringFound = Run(ss, w.names, w.lookups, stringTime);
+
+    if (mapFound != stackFound || mapFound != stringFound)
+    {
+	std::cerr << "Mismatch: " << mapFound << " " << stackFound << " " << stringFound
+		  << std::endl;
+	return 1;
+    }
+    long lookups = (long)Rounds * Depth * LookupsPerScope;
+    std::cout << "deque of std::map:     " << mapTime << "s, "
+	      << lookups / mapTime / 1e6 << "M lookups/s" << std::endl;
+    std::cout << "Stack, SymbolId:       " << stackTime << "s, "
+	      << lookups / stackTime / 1e6 << "M lookups/s" << std::endl;
+    std::cout << "Stack, std::string:    " << stringTime << "s, "
+	      << lookups / stringTime / 1e6 << "M lookups/s" << std::endl;
+    return 0;
+}
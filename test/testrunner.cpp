@@ -224,6 +224,172 @@ bool CompileTimeError::Result()
     return Check(errname,  tplname);
 }
 
+// Class that compiles twice with the unit cache: the first compile starts from an
+// empty cache and builds the used units on their own, the second one uses the
+// precompiled units. The output of both programs is checked. The flags choose how
+// the units are built: with -unit-cache after the program, with -make before it.
+class UnitCacheTestCase : public TestCase
+{
+public:
+    UnitCacheTestCase(const std::string& nm, const std::string& src, const std::string& arg,
+		      const std::string& flg = "-unit-cache");
+    virtual void Clean();
+    virtual bool Compile(const std::string& options);
+private:
+    std::string flags;
+};
+
+UnitCacheTestCase::UnitCacheTestCase(const std::string& nm, const std::string& src,
+				     const std::string& arg, const std::string& flg)
+    : TestCase(nm, src, arg), flags(flg)
+{
+}
+
+void UnitCacheTestCase::Clean()
+{
+    TestCase::Clean();
+    RunCmd("rm -f " + Dir() + "/*.pui");
+}
+
+bool UnitCacheTestCase::Compile(const std::string& options)
+{
+    return TestCase::Compile(options + " " + flags) && Run() && Result() &&
+	TestCase::Compile(options + " " + flags);
+}
+
+// Class that runs the program with -run, in the compiler, instead of compiling an
+// executable. The options are not used, as the JIT only runs 64-bit code. The
+// flags are given to the compiler as well as -run.
+class JitTestCase : public TestCase
+{
+public:
+    JitTestCase(const std::string& nm, const std::string& src, const std::string& arg,
+		const std::string& fl = "");
+    virtual void Clean();
+    virtual bool Compile(const std::string& options);
+    virtual bool Run();
+private:
+    std::string flags;
+};
+
+JitTestCase::JitTestCase(const std::string& nm, const std::string& src, const std::string& arg,
+			 const std::string& fl)
+    : TestCase(nm, src, arg), flags(fl)
+{
+}
+
+void JitTestCase::Clean()
+{
+    TestCase::Clean();
+    RunCmd("rm -f " + Dir() + "/*.pui");
+}
+
+bool JitTestCase::Compile(const std::string&)
+{
+    return true;
+}
+
+bool JitTestCase::Run()
+{
+    std::string resname = replace_ext(source, ".pas", ".res");
+    if (RunCmd("cd " + Dir() + "; ../" + compiler + " " + flags + " -run ./" + source + " -- " + args +
+	       " > " + resname))
+    {
+	return false;
+    }
+    return true;
+}
+
+// Class that checks that the generated code has no call to a function, given as the
+// argument. Used to check that runtime functions are inlined at -O2, and that range
+// checks the compiler can prove redundant are gone. The options are not used.
+class NoCallTestCase : public TestCase
+{
+public:
+    NoCallTestCase(const std::string& nm, const std::string& src, const std::string& arg,
+		   const std::string& flg);
+    virtual void Clean();
+    virtual bool Compile(const std::string& options);
+    virtual bool Run();
+    virtual bool Result();
+private:
+    std::string flags;
+};
+
+NoCallTestCase::NoCallTestCase(const std::string& nm, const std::string& src,
+			       const std::string& arg, const std::string& flg)
+    : TestCase(nm, src, arg), flags(flg)
+{
+}
+
+void NoCallTestCase::Clean()
+{
+    std::string llname = Dir() + "/" + replace_ext(source, ".pas", ".ll");
+    remove(llname.c_str());
+}
+
+bool NoCallTestCase::Compile(const std::string&)
+{
+    return TestCase::Compile(flags + " -emit=llvm");
+}
+
+bool NoCallTestCase::Run()
+{
+    std::string llname = Dir() + "/" + replace_ext(source, ".pas", ".ll");
+    return RunCmd("grep -q 'call .*@" + args + "(' " + llname) != 0;
+}
+
+bool NoCallTestCase::Result()
+{
+    return true;
+}
+
+// Class that compiles with range checks, and expects the program to stop with a
+// range error. The error message is checked against the template.
+class RangeErrorTestCase : public TestCase
+{
+public:
+    RangeErrorTestCase(const std::string& nm, const std::string& src, const std::string& arg);
+    virtual void Clean();
+    virtual bool Compile(const std::string& options);
+    virtual bool Run();
+    virtual bool Result();
+};
+
+RangeErrorTestCase::RangeErrorTestCase(const std::string& nm, const std::string& src,
+				       const std::string& arg)
+    : TestCase(nm, src, arg)
+{
+}
+
+void RangeErrorTestCase::Clean()
+{
+    TestCase::Clean();
+    std::string errname = Dir() + "/" + replace_ext(source, ".pas", ".err");
+    remove(errname.c_str());
+}
+
+bool RangeErrorTestCase::Compile(const std::string& options)
+{
+    return TestCase::Compile(options + " -Cr");
+}
+
+bool RangeErrorTestCase::Run()
+{
+    std::string exename = replace_ext(source, ".pas", "");
+    std::string resname = replace_ext(source, ".pas", ".res");
+    std::string errname = replace_ext(source, ".pas", ".err");
+    return RunCmd("cd " + Dir() + "; ./" + exename + " " + args + " > " + resname +
+		  " 2> " + errname) != 0;
+}
+
+bool RangeErrorTestCase::Result()
+{
+    std::string errname = Dir() + "/" + replace_ext(source, ".pas", ".err");
+    std::string tplname = "expected/" + Dir() + "/" + replace_ext(source, ".pas", ".tpl");
+    return Check(errname,  tplname);
+}
+
 TestCase* TestCaseFactory(const std::string& type,
 			  const std::string& name,
 			  const std::string& source,
@@ -244,6 +410,41 @@ TestCase* TestCaseFactory(const std::string& type,
 	return new CompileTimeError(name, source, args);
     }
 
+    if (type == "UnitCache")
+    {
+	return new UnitCacheTestCase(name, source, args);
+    }
+
+    if (type == "Make")
+    {
+	return new UnitCacheTestCase(name, source, args, "-make -j2");
+    }
+
+    if (type == "Jit")
+    {
+	return new JitTestCase(name, source, args);
+    }
+
+    if (type == "RuntimeInline")
+    {
+	return new NoCallTestCase(name, source, args, "-O2");
+    }
+
+    if (type == "NoRangeCheck")
+    {
+	return new NoCallTestCase(name, source, "range_error", "-Cr");
+    }
+
+    if (type == "RangeError")
+    {
+	return new RangeErrorTestCase(name, source, args);
+    }
+
+    if (type == "JitUnitCache")
+    {
+	return new JitTestCase(name, source, args, "-unit-cache");
+    }
+
     assert(type == "Basic");
     return new TestCase(name, source, args);
 }
@@ -337,6 +538,12 @@ TestEntry testCaseList[] =
     { LACSAP_ONLY, "Basic", "Case",          "case.pas",        "" },
     { 0,           "Basic", "Case 2",        "case2.pas",       " < case2.in" },
     { 0,           "Basic", "CaseCompat",    "casecompat.pas",  "" },
+    { 0,           "Basic", "Case ranges",   "caserange.pas",   "" },
+    { 0,           "Basic", "Range loops",   "rangeloop.pas",   "" },
+    { 0,           "Basic", "Range constant","rangeconst.pas",  "" },
+    { LACSAP_ONLY, "NoRangeCheck", "No range check", "rangeconst.pas", "" },
+    { LACSAP_ONLY, "RangeError", "Range error", "rangeerr.pas",  "" },
+    { LACSAP_ONLY, "RangeError", "Range loop var", "rangeloopvar.pas", "" },
     { 0,           "Basic", "TestSet",       "testset.pas",     "" },
     { 0,           "Basic", "TestSet 2",     "testset2.pas",    "" },
     { LACSAP_ONLY, "Basic", "TestSet 3",     "testset3.pas",    "" },
@@ -367,6 +574,7 @@ TestEntry testCaseList[] =
     { 0,           "Basic", "Variant Record","variant.pas",     "" },
     // Variant variable not supported.
     { LACSAP_ONLY, "Basic", "Variant Rec2",  "variant2.pas",    "" },
+    { 0,           "Basic", "Alias",         "alias.pas",       "" },
     { 0,           "Basic", "Quicksort",     "qsort.pas",       "< numbers.txt" },
     { 0,           "Basic", "Calc Words",    "calcwords.pas",   "< /usr/share/dict/words" },
     // Free pascal doesn't support __FILE__ and __LINE__
@@ -391,6 +599,7 @@ TestEntry testCaseList[] =
     // fmod not supported by FPC.
     { LACSAP_ONLY, "Basic", "course",        "course.pas",      "< course.in" },
     { 0,           "Basic", "loop",          "loop.pas",        "" },
+    { 0,           "Basic", "For loops",     "forloop.pas",     "" },
     // Object handling is not yet compatible.
     { LACSAP_ONLY, "Basic", "obj",           "obj.pas",         "" },
     { LACSAP_ONLY, "Basic", "Virtuals",      "virt.pas",        "" },
@@ -418,6 +627,13 @@ TestEntry testCaseList[] =
     { 0,           "Basic", "Double Begin",  "doublebegin.pas", "" },
     { 0,           "Basic", "Simple unit",   "unit_main.pas",   "" },
     { 0,           "Basic", "Simple unit2",  "unit_main2.pas",  "" },
+    { 0,           "UnitCache", "Unit cache", "unit_main.pas",  "" },
+    { 0,           "UnitCache", "Unit cache object", "unit_main2.pas", "" },
+    { LACSAP_ONLY, "Make",  "Make units",    "unit_make.pas",   "" },
+    { LACSAP_ONLY, "Jit",   "JitParam",      "param.pas",       "1 fun \"quoted string\"" },
+    { LACSAP_ONLY, "JitUnitCache", "Jit unit cache", "unit_main.pas", "" },
+    { 0,           "Basic", "Set inline",    "setinline.pas",   "" },
+    { LACSAP_ONLY, "RuntimeInline", "Runtime inline", "setinline.pas", "__SetContains" },
     { LACSAP_ONLY, "Basic", "Pack & Unpack", "packunpack.pas",  "" },
     { 0,           "Basic", "With statement","with.pas",        "" },
     { LACSAP_ONLY, "Basic", "ISO 7185 PAT",  "iso7185pat.pas",  "" },
@@ -495,13 +711,13 @@ int main(int argc, char **argv)
     std::vector<TestCase*> tc;
     TestResult res;
     std::string mode = "full";
-    std::vector<std::string> optimizations = { "", "-O0", "-O1", "-O2" };
+    std::vector<std::string> optimizations = { "", "-O0", "-O1", "-O2", "-O3", "-Os" };
     std::vector<std::string> models = { "",
 #if M32_DISABLE == 0
 					"-m32", "-m64"
 #endif
     };
-    std::vector<std::string> others = { "", "-Cr", "-g" };
+    std::vector<std::string> others = { "", "-Cr", "-g", "-j4", "-thin-lto" };
     int flags = 0;
     int negative = false;
 
@@ -517,6 +733,11 @@ int main(int argc, char **argv)
 	{
 	    negative = true;
 	}
+	else if (std::string(argv[i]) == "-S" && i + 1 < argc)
+	{
+	    // Compile with a compile server, listening on the (absolute) socket path.
+	    compiler = compilers[0] + " -connect=" + argv[++i];
+	}
 	else
 	{
 	    mode = argv[i];
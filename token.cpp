@@ -4,11 +4,13 @@
 #include <sstream>
 #include <iostream>
 #include <algorithm>
+#include <iterator>
+#include <cstring>
 
 
-Token::Token() : type(Token::Unknown), where("", 0, 0) {}
+Token::Token() : type(Token::Unknown), where("", 0, 0), strPtr(0), strLen(0), symbol(0) {}
 
-Token::Token(TokenType t, const Location& w): type(t), where(w)
+Token::Token(TokenType t, const Location& w): type(t), where(w), strPtr(0), strLen(0), symbol(0)
 {
     if (where)
     {
@@ -19,19 +21,33 @@ Token::Token(TokenType t, const Location& w): type(t), where(w)
     }
 }
 
-Token::Token(TokenType t, const Location& w, const std::string& str): type(t), where(w), strVal(str)
+Token::Token(TokenType t, const Location& w, const std::string& str)
+    : type(t), where(w), strVal(str), strPtr(0), strLen(0), symbol(0)
 {
     assert((t ==  Token::Identifier || Token::StringLiteral) &&
 	   "Invalid token for string argument");
     assert((t == Token::StringLiteral || str != "") && "String should not be empty for identifier");
+    if (t == Token::Identifier)
+    {
+	symbol = Intern(str);
+    }
+}
+
+Token::Token(TokenType t, const Location& w, const char* str, size_t len)
+    : type(t), where(w), strPtr(str), strLen(len), symbol(Intern(str, len))
+{
+    assert(t == Token::Identifier && "Invalid token for buffer argument");
+    assert(len != 0 && "String should not be empty for identifier");
 }
 
-Token::Token(TokenType t, const Location& w, uint64_t v) : type(t), where(w), intVal(v)
+Token::Token(TokenType t, const Location& w, uint64_t v)
+    : type(t), where(w), strPtr(0), strLen(0), symbol(0), intVal(v)
 {
     assert(t == Token::Integer || t == Token::Char);
 }
 
-Token::Token(TokenType t, const Location& w, double v) : type(t), where(w), realVal(v)
+Token::Token(TokenType t, const Location& w, double v)
+    : type(t), where(w), strPtr(0), strLen(0), symbol(0), realVal(v)
 {
     assert(t == Token::Real);
 }
@@ -59,7 +75,7 @@ void Token::dump(std::ostream& out, const char* file, int line) const
     switch(type)
     {
     case Token::Identifier:
-	out << strVal << " ";
+	out << GetIdentName() << " ";
 	break;
 
     case Token::StringLiteral:
@@ -189,54 +205,152 @@ const TokenEntry tokenTable[] =
     { Token::EndOfFile,     false, -1, "EOF" },
 };
 
-static const TokenEntry* FindToken(Token::TokenType type)
+// Direct lookup tables, built once from tokenTable. TokenType is used as an index
+// for name and precedence, and keywords are found through a perfect hash - a hash
+// function with a multiplier chosen so that no two keywords share a slot.
+class TokenLookup
 {
-    for(auto &i : tokenTable)
+public:
+    static const TokenLookup& Get()
+    {
+	static const TokenLookup lookup;
+	return lookup;
+    }
+
+    const TokenEntry* ByType(Token::TokenType type) const
+    {
+	const TokenEntry* t = byType[Index(type)];
+	assert(t && "Expect to find token!");
+	return t;
+    }
+
+    const TokenEntry* ByKeyWord(const char* str, size_t len) const
     {
-	if (type == i.type)
+	if (len == 0 || len > maxLen)
 	{
-	    return &i;
+	    return 0;
 	}
+	size_t h = Hash(str, len, mult);
+	const TokenEntry* t = keyWords[h];
+	if (!t || keyWordLen[h] != len)
+	{
+	    return 0;
+	}
+	/* Don't "tolower" the keyword if it starts with __ */
+	bool exact = (len >= 2 && str[0] == '_' && str[1] == '_');
+	for(size_t i = 0; i < len; i++)
+	{
+	    char ch = exact ? str[i] : Lower(str[i]);
+	    if (ch != t->str[i])
+	    {
+		return 0;
+	    }
+	}
+	return t;
     }
-    assert(0 && "Expect to find token!");
-    return 0;
-}
 
-static const TokenEntry* FindToken(std::string kw)
-{
-    /* Don't "tolower" the keyword if it starts with __ */
-    if (kw.substr(0,2) != "__")
+private:
+    static const int    NumTypes = Token::UntermString + 3;
+    static const size_t HashSize = 512;
+
+    TokenLookup() : byType(), keyWords(), keyWordLen(), mult(0), maxLen(0)
+    {
+	for(auto &i : tokenTable)
+	{
+	    // First entry wins, as there are synonyms in the table.
+	    const TokenEntry*& t = byType[Index(i.type)];
+	    if (!t)
+	    {
+		t = &i;
+	    }
+	    if (i.isKeyWord)
+	    {
+		maxLen = std::max(maxLen, strlen(i.str));
+	    }
+	}
+	for(mult = 31; !Fill(); mult += 2)
+	    ;
+    }
+
+    bool Fill()
     {
-	strlower(kw);
+	std::fill(std::begin(keyWords), std::end(keyWords), nullptr);
+	for(auto &i : tokenTable)
+	{
+	    if (i.isKeyWord)
+	    {
+		size_t len = strlen(i.str);
+		size_t h = Hash(i.str, len, mult);
+		if (keyWords[h])
+		{
+		    return false;
+		}
+		keyWords[h] = &i;
+		keyWordLen[h] = len;
+	    }
+	}
+	return true;
     }
-    for(auto &i : tokenTable)
+
+    static int Index(Token::TokenType type)
     {
-	if (kw == i.str)
+	switch(type)
 	{
-	    return &i;
+	case Token::EndOfFile:
+	    return NumTypes - 2;
+	case Token::Unknown:
+	    return NumTypes - 1;
+	default:
+	    assert(type >= 0 && type < NumTypes - 2 && "Token type out of range");
+	    return type;
 	}
     }
-    return 0;
-}
+
+    static char Lower(char ch)
+    {
+	return (ch >= 'A' && ch <= 'Z') ? ch - 'A' + 'a' : ch;
+    }
+
+    static size_t Hash(const char* str, size_t len, uint32_t mult)
+    {
+	uint32_t h = len;
+	for(size_t i = 0; i < len; i++)
+	{
+	    h = h * mult + Lower(str[i]);
+	}
+	return (h ^ (h >> 16)) & (HashSize - 1);
+    }
+
+private:
+    const TokenEntry* byType[NumTypes];
+    const TokenEntry* keyWords[HashSize];
+    // Length of each keyword, so a longer identifier never reads past its end.
+    size_t            keyWordLen[HashSize];
+    uint32_t          mult;
+    size_t            maxLen;
+};
 
 std::string Token::TypeStr() const
 {
-    const TokenEntry* t  = FindToken(type);
-    return t->str;
+    return TokenLookup::Get().ByType(type)->str;
 }
 
 int Token::Precedence() const
 {
-    const TokenEntry* t  = FindToken(type);
-    return t->precedence;
+    return TokenLookup::Get().ByType(type)->precedence;
 }
 
-Token::TokenType Token::KeyWordToToken(const std::string &str)
+Token::TokenType Token::KeyWordToToken(const char* str, size_t len)
 {
-    const TokenEntry* t = FindToken(str);
-    if (t && t->isKeyWord)
+    const TokenEntry* t = TokenLookup::Get().ByKeyWord(str, len);
+    if (t)
     {
 	return t->type;
     }
     return Token::Unknown;
 }
+
+Token::TokenType Token::KeyWordToToken(const std::string &str)
+{
+    return KeyWordToToken(str.data(), str.size());
+}
@@ -2,6 +2,7 @@
 #define TOKEN_H
 
 #include "location.h"
+#include "symbol.h"
 
 #include <cassert>
 #include <string>
@@ -131,18 +132,31 @@ public:
 	
     Token(TokenType t, const Location& w);
     Token(TokenType t, const Location& w, const std::string& str);
+    // Identifier that refers directly to the lexer's input buffer.
+    Token(TokenType t, const Location& w, const char* str, size_t len);
     Token(TokenType t, const Location& w, uint64_t v);
     Token(TokenType t, const Location& w, double v);
 
     static TokenType KeyWordToToken(const std::string& str);
+    static TokenType KeyWordToToken(const char* str, size_t len);
 
     TokenType GetToken() const { return type; }
     std::string GetIdentName() const 
     { 
 	assert(type == Token::Identifier && "Incorrect type for identname");
+	if (strPtr)
+	{
+	    return std::string(strPtr, strLen);
+	}
 	assert(strVal.size() != 0 && "String should not be empty!");
 	return strVal; 
     }
+    // Interned (case-folded) identifier name.
+    SymbolId GetSymbol() const
+    {
+	assert(type == Token::Identifier && "Incorrect type for symbol");
+	return symbol;
+    }
 
     uint64_t GetIntVal() const 
     { 
@@ -183,6 +197,10 @@ private:
     
     // Values. 
     std::string strVal; 
+    // Identifier name in the source buffer, only valid while the source is alive.
+    const char* strPtr;
+    size_t      strLen;
+    SymbolId    symbol;
     uint64_t    intVal;
     double      realVal;
 };
@@ -1277,6 +1277,15 @@ namespace Types
     }
 
 /* Static variables in Types. */
+    // The basic types are shared between compilations, so they don't go in the
+    // compilation's arena.
+    template<typename T, typename... Args>
+    static TypeDecl* NewGlobalType(Args... args)
+    {
+	ArenaScope scope(Arena::Global());
+	return new T(args...);
+    }
+
     static TypeDecl* voidType = 0;
     static TypeDecl* textType = 0;
     static TypeDecl* strType = 0;
@@ -1290,7 +1299,7 @@ namespace Types
     {
 	if (!voidType)
 	{
-	    voidType = new VoidDecl;
+	    voidType = NewGlobalType<VoidDecl>();
 	}
 	return voidType;
     }
@@ -1299,7 +1308,7 @@ namespace Types
     {
 	if (!strType)
 	{
-	    strType = new StringDecl(255);
+	    strType = NewGlobalType<StringDecl>(255);
 	}
 	return strType;
     }
@@ -1308,7 +1317,7 @@ namespace Types
     {
 	if (!textType)
 	{
-	    textType = new TextDecl;
+	    textType = NewGlobalType<TextDecl>();
 	}
 	return textType;
     }
@@ -1317,7 +1326,7 @@ namespace Types
     {
 	if (!integerType)
 	{
-	    integerType = new IntegerDecl;
+	    integerType = NewGlobalType<IntegerDecl>();
 	}
 	return integerType;
     }
@@ -1326,7 +1335,7 @@ namespace Types
     {
 	if (!longIntType)
 	{
-	    longIntType = new Int64Decl;
+	    longIntType = NewGlobalType<Int64Decl>();
 	}
 	return longIntType;
     }
@@ -1335,7 +1344,7 @@ namespace Types
     {
 	if (!charType)
 	{
-	    charType = new CharDecl;
+	    charType = NewGlobalType<CharDecl>();
 	}
 	return charType;
     }
@@ -1344,7 +1353,7 @@ namespace Types
     {
 	if (!realType)
 	{
-	    realType = new RealDecl;
+	    realType = NewGlobalType<RealDecl>();
 	}
 	return realType;
     }
@@ -1353,11 +1362,128 @@ namespace Types
     {
 	if (!booleanType)
 	{
-	    booleanType = new BoolDecl;
+	    booleanType = NewGlobalType<BoolDecl>();
 	}
 	return booleanType;
     }
 
+    static TypeContext* currentContext = 0;
+
+    TypeContext::TypeContext() : prev(currentContext), arena(&Arena::Current())
+    {
+	currentContext = this;
+    }
+
+    TypeContext::~TypeContext()
+    {
+	currentContext = prev;
+    }
+
+    // The context to unique types in, if the type will be allocated in its arena.
+    TypeContext* TypeContext::Current()
+    {
+	if (currentContext && currentContext->arena == &Arena::Current())
+	{
+	    return currentContext;
+	}
+	return 0;
+    }
+
+    Range* MakeRange(int64_t start, int64_t end)
+    {
+	TypeContext* ctx = TypeContext::Current();
+	if (!ctx)
+	{
+	    return new Range(start, end);
+	}
+	Range*& r = ctx->ranges[std::make_pair(start, end)];
+	if (!r)
+	{
+	    r = new Range(start, end);
+	}
+	return r;
+    }
+
+    RangeDecl* MakeRangeDecl(int64_t start, int64_t end, TypeDecl* base)
+    {
+	TypeContext* ctx = TypeContext::Current();
+	if (!ctx)
+	{
+	    return new RangeDecl(new Range(start, end), base);
+	}
+	RangeDecl*& r = ctx->rangeDecls[std::make_tuple(start, end, base)];
+	if (!r)
+	{
+	    r = new RangeDecl(MakeRange(start, end), base);
+	}
+	return r;
+    }
+
+    RangeDecl* MakeRangeDecl(Range* r, TypeDecl* base)
+    {
+	return MakeRangeDecl(r->Start(), r->End(), base);
+    }
+
+    ArrayDecl* MakeArrayDecl(TypeDecl* base, const std::vector<RangeDecl*>& ranges)
+    {
+	TypeContext* ctx = TypeContext::Current();
+	if (!ctx)
+	{
+	    return new ArrayDecl(base, ranges);
+	}
+	ArrayDecl*& a = ctx->arrays[std::make_pair(base, ranges)];
+	if (!a)
+	{
+	    a = new ArrayDecl(base, ranges);
+	}
+	return a;
+    }
+
+    PointerDecl* MakePointerDecl(TypeDecl* base)
+    {
+	TypeContext* ctx = TypeContext::Current();
+	if (!ctx)
+	{
+	    return new PointerDecl(base);
+	}
+	PointerDecl*& p = ctx->pointers[base];
+	if (!p)
+	{
+	    p = new PointerDecl(base);
+	}
+	return p;
+    }
+
+    SetDecl* MakeSetDecl(RangeDecl* range, TypeDecl* base)
+    {
+	TypeContext* ctx = TypeContext::Current();
+	if (!ctx || !range)
+	{
+	    return new SetDecl(range, base);
+	}
+	SetDecl*& s = ctx->sets[std::make_pair(range, base)];
+	if (!s)
+	{
+	    s = new SetDecl(range, base);
+	}
+	return s;
+    }
+
+    StringDecl* MakeStringDecl(unsigned size)
+    {
+	TypeContext* ctx = TypeContext::Current();
+	if (!ctx)
+	{
+	    return new StringDecl(size);
+	}
+	StringDecl*& s = ctx->strings[size];
+	if (!s)
+	{
+	    s = new StringDecl(size);
+	}
+	return s;
+    }
+
     void Finalize(llvm::DIBuilder* builder)
     {
 	for(auto t : fwdMap)
@@ -1374,6 +1500,11 @@ namespace Types
 
 bool operator==(const Types::TypeDecl& lty, const Types::TypeDecl& rty)
 {
+    // Uniqued types are the same object.
+    if (&lty == &rty)
+    {
+	return true;
+    }
     return lty.SameAs(&rty);
 }
 
@@ -1,10 +1,14 @@
 #ifndef TYPES_H
 #define TYPES_H
 
+#include "arena.h"
 #include <llvm/IR/Type.h>
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/DIBuilder.h>
 #include <string>
+#include <vector>
+#include <map>
+#include <tuple>
 
 class PrototypeAST;
 class ExprAST;
@@ -23,6 +27,24 @@ namespace Types
     TypeDecl* GetTextType();
     TypeDecl* GetStringType();
 
+    class Range;
+    class RangeDecl;
+    class ArrayDecl;
+    class PointerDecl;
+    class SetDecl;
+    class StringDecl;
+
+    // Anonymous types, made through the type context if there is one (see below).
+    Range* MakeRange(int64_t start, int64_t end);
+    RangeDecl* MakeRangeDecl(int64_t start, int64_t end, TypeDecl* base);
+    RangeDecl* MakeRangeDecl(Range* r, TypeDecl* base);
+    ArrayDecl* MakeArrayDecl(TypeDecl* base, const std::vector<RangeDecl*>& ranges);
+    // Only for pointers to known types - forward declared ones get filled in later.
+    PointerDecl* MakePointerDecl(TypeDecl* base);
+    // Sets with no range yet get their range filled in later, so are not uniqued.
+    SetDecl* MakeSetDecl(RangeDecl* range, TypeDecl* base);
+    StringDecl* MakeStringDecl(unsigned size);
+
     /* Range is either created by the user, or calculated on basetype */
     class Range
     {
@@ -83,6 +105,8 @@ namespace Types
 
 	virtual TypeKind Type() const { return kind; }
 	virtual ~TypeDecl() {}
+	static void* operator new(size_t size) { return Arena::Allocate(size, Arena::Type); }
+	static void operator delete(void*) {}
 	virtual bool IsIncomplete() const { return false; }
 	virtual bool IsIntegral() const { return false; }
 	virtual bool IsCompound() const { return false; }
@@ -592,7 +616,7 @@ namespace Types
     class TextDecl : public FileDecl
     {
     public:
-	TextDecl() : FileDecl(TK_Text, new CharDecl) {}
+	TextDecl() : FileDecl(TK_Text, GetCharType()) {}
 	void DoDump(std::ostream& out) const override;
 	bool HasLlvmType() const override { return true; }
 	static bool classof(const TypeDecl* e) { return e->getKind() == TK_Text; }
@@ -631,8 +655,8 @@ namespace Types
     {
     public:
 	StringDecl(unsigned size)
-	    : ArrayDecl(TK_String, new CharDecl, 
-			std::vector<RangeDecl*>(1, new RangeDecl(new Range(0, size), GetIntegerType())))
+	    : ArrayDecl(TK_String, GetCharType(),
+			std::vector<RangeDecl*>(1, MakeRangeDecl(0, size, GetIntegerType())))
 	{
 	    assert(size > 0 && "Zero size not allowed");
 	}
@@ -645,6 +669,39 @@ namespace Types
 
     llvm::Type* GetVoidPtrType();
 
+    // Anonymous ranges, arrays, sets, pointers and strings are uniqued, so
+    // that structurally identical types are the same object and can be
+    // compared by pointer. The types live in the compilation's arena, so
+    // there is one TypeContext per compilation. Without one, or when
+    // allocating in another arena, every call makes a new type.
+    class TypeContext
+    {
+    public:
+	TypeContext();
+	~TypeContext();
+	static TypeContext* Current();
+
+    private:
+	TypeContext(const TypeContext&) = delete;
+	TypeContext& operator=(const TypeContext&) = delete;
+
+	friend Range* MakeRange(int64_t start, int64_t end);
+	friend RangeDecl* MakeRangeDecl(int64_t start, int64_t end, TypeDecl* base);
+	friend ArrayDecl* MakeArrayDecl(TypeDecl* base, const std::vector<RangeDecl*>& ranges);
+	friend PointerDecl* MakePointerDecl(TypeDecl* base);
+	friend SetDecl* MakeSetDecl(RangeDecl* range, TypeDecl* base);
+	friend StringDecl* MakeStringDecl(unsigned size);
+
+	TypeContext* prev;
+	Arena*       arena;
+	std::map<std::pair<int64_t, int64_t>, Range*>                     ranges;
+	std::map<std::tuple<int64_t, int64_t, TypeDecl*>, RangeDecl*>     rangeDecls;
+	std::map<std::pair<TypeDecl*, std::vector<RangeDecl*>>, ArrayDecl*> arrays;
+	std::map<TypeDecl*, PointerDecl*>                                 pointers;
+	std::map<std::pair<RangeDecl*, TypeDecl*>, SetDecl*>              sets;
+	std::map<unsigned, StringDecl*>                                   strings;
+    };
+
     void Finalize(llvm::DIBuilder* builder);
 } // Namespace Types
 
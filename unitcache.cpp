@@ -0,0 +1,205 @@
+#include "unitcache.h"
+#include "binary.h"
+#include "options.h"
+#include "source.h"
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MD5.h>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+namespace UnitCache
+{
+    static const char* const formatId = "lacsap-pui 1";
+
+    struct UnitFile
+    {
+	std::string source;
+	std::string hash;
+	std::string object;
+    };
+
+    static std::vector<UnitFile>    used;
+    static std::vector<std::string> stale;
+    static bool                     uncacheable;
+
+    static std::string Absolute(const std::string& name)
+    {
+	llvm::SmallString<256> path(name);
+	llvm::sys::fs::make_absolute(path);
+	return path.str().str();
+    }
+
+    static std::string OrDash(const std::string& s)
+    {
+	return s.empty() ? "-" : s;
+    }
+
+    // Objects built with different options, or for another target, can't be used.
+    static std::string Flags()
+    {
+	std::stringstream ss;
+	ss << "flags " << optimization << " " << rangeCheck << " " << debugInfo << " " << model
+	   << " " << profileGenerate << " " << (profileUse.empty() ? "-" : HashFile(profileUse))
+	   << " " << thinLTO << " " << standard << " " << caseInsensitive
+	   << " " << TargetTriple() << " " << OrDash(TargetCPU()) << " " << OrDash(TargetFeatures());
+	return ss.str();
+    }
+
+    static void AddUsed(const UnitFile& unit)
+    {
+	for(auto& u : used)
+	{
+	    if (u.source == unit.source)
+	    {
+		return;
+	    }
+	}
+	used.push_back(unit);
+    }
+
+    // Read "<kind>\t<hash>\t<object>\t<source>".
+    static bool ReadUnitLine(const std::string& line, std::string& kind, UnitFile& unit)
+    {
+	std::stringstream ss(line);
+	return std::getline(ss, kind, '\t') && std::getline(ss, unit.hash, '\t') &&
+	    std::getline(ss, unit.object, '\t') && std::getline(ss, unit.source);
+    }
+
+    static bool IsValid(const UnitFile& unit, const std::string& hash)
+    {
+	return unit.hash == hash && llvm::sys::fs::exists(unit.object);
+    }
+
+    std::string Hash(const char* data, size_t size)
+    {
+	llvm::MD5 md5;
+	md5.update(llvm::StringRef(data, size));
+	llvm::MD5::MD5Result result;
+	md5.final(result);
+	llvm::SmallString<32> str;
+	llvm::MD5::stringifyResult(result, str);
+	return str.str().str();
+    }
+
+    std::string HashFile(const std::string& fileName)
+    {
+	MappedFileSource source(fileName);
+	if (!source)
+	{
+	    return "";
+	}
+	return Hash(source.Data(), source.Size());
+    }
+
+    bool Use(const std::string& fileName, const std::string& hash)
+    {
+	std::ifstream in(replace_ext(fileName, ".pas", ".pui"));
+	std::string line;
+	if (!std::getline(in, line) || line != formatId ||
+	    !std::getline(in, line) || line != Flags())
+	{
+	    return false;
+	}
+
+	std::vector<UnitFile> units;
+	std::string kind;
+	UnitFile unit;
+	while(std::getline(in, line))
+	{
+	    if (!ReadUnitLine(line, kind, unit))
+	    {
+		return false;
+	    }
+	    // The unit itself comes first, followed by its dependencies.
+	    if (units.empty() ? kind != "unit" || !IsValid(unit, hash) :
+		kind != "dep" || !IsValid(unit, HashFile(unit.source)))
+	    {
+		return false;
+	    }
+	    units.push_back(unit);
+	}
+	if (units.empty())
+	{
+	    return false;
+	}
+	// Dependencies before the unit itself.
+	for(auto u = units.rbegin(); u != units.rend(); u++)
+	{
+	    AddUsed(*u);
+	}
+	return true;
+    }
+
+    bool IsUpToDate(const std::string& fileName)
+    {
+	std::vector<UnitFile> saved = used;
+	bool result = Use(fileName, HashFile(fileName));
+	used.swap(saved);
+	return result;
+    }
+
+    std::vector<std::string> Objects()
+    {
+	std::vector<std::string> objects;
+	for(auto& u : used)
+	{
+	    objects.push_back(u.object);
+	}
+	return objects;
+    }
+
+    bool Write(const std::string& fileName, const std::string& hash, const std::string& objName)
+    {
+	std::string puiName = replace_ext(fileName, ".pas", ".pui");
+	if (uncacheable)
+	{
+	    llvm::sys::fs::remove(puiName);
+	    return true;
+	}
+	std::ofstream out(puiName);
+	out << formatId << "\n" << Flags() << "\n";
+	out << "unit\t" << hash << "\t" << Absolute(objName) << "\t" << Absolute(fileName) << "\n";
+	for(auto& u : used)
+	{
+	    out << "dep\t" << u.hash << "\t" << u.object << "\t" << u.source << "\n";
+	}
+	if (!out)
+	{
+	    std::cerr << "Could not write " << puiName << std::endl;
+	    return false;
+	}
+	return true;
+    }
+
+    void Reset()
+    {
+	used.clear();
+	uncacheable = false;
+    }
+
+    void SetUncacheable()
+    {
+	uncacheable = true;
+    }
+
+    void AddStale(const std::string& fileName)
+    {
+	for(auto& s : stale)
+	{
+	    if (s == fileName)
+	    {
+		return;
+	    }
+	}
+	stale.push_back(fileName);
+    }
+
+    std::vector<std::string> TakeStale()
+    {
+	std::vector<std::string> result;
+	result.swap(stale);
+	return result;
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef UNITCACHE_H
+#define UNITCACHE_H
+
+#include <string>
+#include <vector>
+
+// Precompiled units. With -unit-cache, a unit that a program uses is compiled on its
+// own into <unit>.o, and <unit>.pui is written next to it. The .pui holds the hash of
+// the unit source and of every unit it was compiled against, and the compiler
+// options used. While these still match, "uses" parses only the interface part of
+// the unit and links the object, instead of compiling the whole unit again.
+namespace UnitCache
+{
+    std::string Hash(const char* data, size_t size);
+    std::string HashFile(const std::string& fileName);
+
+    // Return true if the cached unit is up to date with the given source hash. If
+    // so, the unit and the units it depends on are added to the used units.
+    bool Use(const std::string& fileName, const std::string& hash);
+    // Like Use, but only checks.
+    bool IsUpToDate(const std::string& fileName);
+    // Objects of the used units, to be linked with the program.
+    std::vector<std::string> Objects();
+    // Write the .pui for a unit compiled into objName, depending on the used units.
+    bool Write(const std::string& fileName, const std::string& hash,
+	       const std::string& objName);
+    void Reset();
+    // The unit being compiled exports an object type with methods. The methods and
+    // the vtable are not declared from the interface alone, so Write leaves out the
+    // .pui, and the unit is always compiled in full where it is used.
+    void SetUncacheable();
+
+    // Units that were not up to date, so were compiled in full, in dependency order.
+    void AddStale(const std::string& fileName);
+    std::vector<std::string> TakeStale();
+}
+
+#endif